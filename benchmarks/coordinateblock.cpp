@@ -0,0 +1,180 @@
+// Times the parsing of a mesh point coordinate block with CoordinateBlockParser and with Spirit's
+// repeat[double_], which it replaced.
+//
+// usage: coordinateblock mesh.mphtxt [repeats] [threads]
+//
+// The coordinate block of the first mesh object of mesh.mphtxt, e.g. examples/plate_with_hole,
+// is repeated repeats times (1000 by default) in memory and parsed from there, so that only the
+// parsing is timed.
+
+#include "blockparsers.hpp"
+#include "comsolparser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+struct CoordinateBlock
+{
+  size_t sdim   = 0;
+  size_t points = 0;
+  string text; // One line per point
+};
+
+// Value of the header line of the mesh object ending with label, e.g. "3 # sdim"
+size_t header_value( const string& mesh, const string& label )
+{
+  const auto end = mesh.find( " # " + label + "\n" );
+
+  if ( end == string::npos )
+  {
+    throw runtime_error( "No \"# " + label + "\" line." );
+  }
+  return stoul( mesh.substr( mesh.rfind( '\n', end ) + 1 ) );
+}
+
+CoordinateBlock read_block( const string& file_name )
+{
+  ifstream file( file_name );
+
+  if ( !file.is_open( ) )
+  {
+    throw runtime_error( "Could not open " + file_name + "." );
+  }
+
+  stringstream ss;
+  ss << file.rdbuf( );
+
+  const string    mesh = ss.str( );
+  CoordinateBlock block;
+
+  block.sdim   = header_value( mesh, "sdim" );
+  block.points = header_value( mesh, "number of mesh points" );
+
+  const string title = "# Mesh point coordinates\n";
+  const auto   first = mesh.find( title );
+  const auto   last  = mesh.find( "\n\n", first );
+
+  if ( first == string::npos || last == string::npos )
+  {
+    throw runtime_error( "No mesh point coordinates." );
+  }
+  block.text = mesh.substr( first + title.size( ), last + 1 - first - title.size( ) );
+
+  return block;
+}
+
+// Best of a few runs, in MB/s
+template< class F >
+double throughput( size_t bytes, const F& parse )
+{
+  double best = 0;
+
+  for ( int run = 0; run != 5; run++ )
+  {
+    const auto start = chrono::steady_clock::now( );
+
+    if ( !parse( ) )
+    {
+      throw runtime_error( "Parsing failed." );
+    }
+
+    const chrono::duration< double > elapsed = chrono::steady_clock::now( ) - start;
+
+    best = max( best, bytes / 1.e6 / elapsed.count( ) );
+  }
+  return best;
+}
+
+} // namespace
+
+int main( int ac, char* av[] )
+{
+  try
+  {
+    if ( ac < 2 )
+    {
+      cerr << "usage: " << av[ 0 ] << " mesh.mphtxt [repeats] [threads]\n";
+      return 1;
+    }
+
+    const auto   block   = read_block( av[ 1 ] );
+    const size_t repeats = ac > 2 ? strtoul( av[ 2 ], nullptr, 10 ) : 1000;
+    const size_t threads = ac > 3 ? strtoul( av[ 3 ], nullptr, 10 ) : 1;
+    const size_t points  = block.points * repeats;
+
+    string text;
+
+    text.reserve( block.text.size( ) * repeats );
+    for ( size_t i = 0; i != repeats; i++ )
+    {
+      text += block.text;
+    }
+
+    using Iterator = const char*;
+
+    namespace qi = boost::spirit::qi;
+
+    const Iterator                        first = text.data( );
+    const Iterator                        last  = first + text.size( );
+    const comsol::MeshSkipper< Iterator > skipper;
+
+    vector< double >    spirit_values;
+    Coordinates         block_values;
+
+    const double spirit = throughput( text.size( ), [ & ] {
+      Iterator iter = first;
+
+      spirit_values.clear( );
+      return qi::phrase_parse( iter,
+                               last,
+                               qi::repeat( points )[ qi::repeat( block.sdim )[ qi::double_ ] ],
+                               skipper,
+                               spirit_values );
+    } );
+
+    const double block_parser = throughput( text.size( ), [ & ] {
+      Iterator iter = first;
+
+      return qi::phrase_parse( iter,
+                               last,
+                               comsol::CoordinateBlockParser( block.sdim, points, threads ),
+                               skipper,
+                               block_values );
+    } );
+
+    // Spirit's double_ is not always correctly rounded, from_chars is
+    size_t differing = 0;
+
+    for ( size_t i = 0; i != points; i++ )
+    {
+      for ( size_t d = 0; d != block.sdim; d++ )
+      {
+        differing += spirit_values[ i * block.sdim + d ] != block_values( i, d );
+      }
+    }
+
+    cout << points << " points, " << text.size( ) / 1.e6 << " MB\n"
+         << "  Spirit repeat[double_]: " << spirit << " MB/s\n"
+         << "  CoordinateBlockParser:  " << block_parser << " MB/s (" << threads << " threads)\n"
+         << "  Values read differently: " << differing << "\n";
+  }
+  catch ( exception& e )
+  {
+    cerr << "coordinateblock: Error: " << e.what( ) << "\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Writes a comsol mesh with many selections to the standard output.
+
+usage: selections_mesh.py n domains selections [entities] > mesh.mphtxt
+
+The mesh is a cube of n x n x n hexahedra split in 6 tetrahedra each, in
+domains slabs along z, and the triangles of its 6 faces. Every fourth
+selection holds 2 faces, the others entities domains each (2 by default),
+so that the selections overlap.
+"""
+
+import sys
+
+
+def main():
+    if len(sys.argv) < 4:
+        sys.exit(__doc__)
+
+    n = int(sys.argv[1])
+    domains = int(sys.argv[2])
+    selections = int(sys.argv[3])
+    entities = int(sys.argv[4]) if len(sys.argv) > 4 else 2
+
+    write = sys.stdout.write
+    side = n + 1
+
+    def vertex(i, j, k):
+        return (k * side + j) * side + i
+
+    # The parser expects the header comsol writes
+    write("# Created by COMSOL Multiphysics Fri May  9 09:35:04 2014\n\n\n"
+          "# Major & minor version\n0 1 \n")
+    write("%d # number of tags\n# Tags\n5 mesh1 \n" % (1 + selections))
+    for s in range(selections):
+        write("10 mesh1_sel%d \n" % (s + 1))
+    write("%d # number of types\n# Types\n" % (1 + selections))
+    for s in range(selections + 1):
+        write("3 obj \n")
+
+    write("\n# --------- Object 0 ----------\n\n0 0 1 \n4 Mesh # class\n4 # version\n"
+          "3 # sdim\n%d # number of mesh points\n0 # lowest mesh point index\n\n"
+          "# Mesh point coordinates\n" % side**3)
+    h = 1.0 / n
+    for k in range(side):
+        for j in range(side):
+            for i in range(side):
+                write("%.17g %.17g %.17g \n" % (i * h * 1.1, j * h / 3.0, k * h * 0.7 + 1e-9 * i))
+
+    # The quads of the faces x, y or z = 0 or n, two triangles each
+    faces = [
+        lambda a, b: vertex(a, b, 0), lambda a, b: vertex(a, b, n),
+        lambda a, b: vertex(0, a, b), lambda a, b: vertex(n, a, b),
+        lambda a, b: vertex(a, 0, b), lambda a, b: vertex(a, n, b),
+    ]
+    triangles = []
+    triangle_faces = []
+    for a in range(n):
+        for b in range(n):
+            for face, corner in enumerate(faces):
+                q = [corner(a + da, b + db) for db in (0, 1) for da in (0, 1)]
+                triangles += [(q[0], q[1], q[2]), (q[1], q[3], q[2])]
+                triangle_faces += [face, face]
+
+    write("\n2 # number of element types\n\n# Type #0\n\n3 tri # type name\n\n\n"
+          "3 # number of vertices per element\n%d # number of elements\n# Elements\n"
+          % len(triangles))
+    for t in triangles:
+        write("%d %d %d \n" % t)
+    write("\n%d # number of geometric entity indices\n# Geometric entity indices\n"
+          % len(triangle_faces))
+    for f in triangle_faces:
+        write("%d \n" % f)
+
+    write("\n# Type #1\n\n3 tet # type name\n\n\n4 # number of vertices per element\n"
+          "%d # number of elements\n# Elements\n" % (6 * n**3))
+    tetrahedron_domains = []
+    for k in range(n):
+        for j in range(n):
+            for i in range(n):
+                c = [vertex(i + a, j + b, k + d) for d in (0, 1) for b in (0, 1) for a in (0, 1)]
+                for t in ((0, 1, 3, 7), (0, 1, 5, 7), (0, 2, 3, 7),
+                          (0, 2, 6, 7), (0, 4, 5, 7), (0, 4, 6, 7)):
+                    write("%d %d %d %d \n" % tuple(c[x] for x in t))
+                    tetrahedron_domains.append(1 + (k * domains) // n)
+    write("\n%d # number of geometric entity indices\n# Geometric entity indices\n"
+          % len(tetrahedron_domains))
+    for d in tetrahedron_domains:
+        write("%d \n" % d)
+
+    for s in range(selections):
+        write("\n# --------- Object %d ----------\n\n0 0 1 \n9 Selection # class\n"
+              "0 # Version\n" % (s + 1))
+        label = "Sel %d" % s
+        if s % 4 == 3:
+            dimension = 2
+            selected = [s % 6, (s + 1) % 6]
+        else:
+            dimension = 3
+            selected = [1 + ((s + x) % domains) for x in range(entities)]
+        write("%d %s # Label\n5 mesh1 # Geometry/mesh tag\n%d # Dimension\n"
+              "%d # Number of entities\n# Entities\n"
+              % (len(label), label, dimension, len(selected)))
+        for e in selected:
+            write("%d \n" % e)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Times the conversion of a mesh with many selections to attributes.
+
+usage: time_selections.py comsol2aero [other comsol2aero ...]
+
+Generates the mesh of selections_mesh.py with 1.3M tetrahedra in 60
+domains and 200 selections of 20 entities each, unless it exists, and
+converts it with every given executable with -s -m on one thread. Prints
+the wall time of each run, the best of 3, and the conversion time it
+reports in verbose mode. The outputs of all executables must be the same.
+"""
+
+import filecmp
+import os
+import pty
+import subprocess
+import sys
+import tempfile
+import time
+
+SIZE, DOMAINS, SELECTIONS, ENTITIES = 60, 60, 200, 20
+
+
+def run(executable, mesh, output):
+    # comsol2aero reads an input file only if the standard input is a terminal
+    terminal, device = pty.openpty()
+    try:
+        start = time.perf_counter()
+        result = subprocess.run(
+            [executable, mesh, "-s", "-m", "-v", "-t", "1", "-o", output],
+            stdin=device, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+            universal_newlines=True, check=True)
+        elapsed = time.perf_counter() - start
+    finally:
+        os.close(terminal)
+        os.close(device)
+
+    converted = [line.strip() for line in result.stderr.splitlines()
+                 if line.startswith("Converted in")]
+    return elapsed, converted[0] if converted else ""
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+
+    directory = tempfile.gettempdir()
+    mesh = os.path.join(directory, "selections_%d_%d_%d_%d.mphtxt"
+                        % (SIZE, DOMAINS, SELECTIONS, ENTITIES))
+    if not os.path.exists(mesh):
+        generator = os.path.join(os.path.dirname(os.path.abspath(__file__)), "selections_mesh.py")
+        with open(mesh, "w") as file:
+            subprocess.run([sys.executable, generator] + [str(x) for x in
+                           (SIZE, DOMAINS, SELECTIONS, ENTITIES)], stdout=file, check=True)
+    print("%s: %.1f MB" % (mesh, os.path.getsize(mesh) / 1e6))
+
+    outputs = []
+    for number, executable in enumerate(sys.argv[1:]):
+        output = os.path.join(directory, "selections_%d.top" % number)
+        best, converted = min(run(executable, mesh, output) for _ in range(3))
+        print("%s: %.2f s wall time. %s" % (executable, best, converted))
+        outputs.append(output)
+
+    for output in outputs[1:]:
+        if not filecmp.cmp(outputs[0], output, shallow=False):
+            sys.exit("The outputs of %s and %s differ." % (outputs[0], output))
+    for output in outputs:
+        os.remove(output)
+
+
+if __name__ == "__main__":
+    main()
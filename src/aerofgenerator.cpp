@@ -1,26 +1,32 @@
 #include "aerofgenerator.hpp"
+#include "sectionwriter.hpp"
 #include "utils.hpp"
 #include <iomanip>
 #include <memory>
 #include <set>
+#include <sstream>
 
 namespace aerof
 {
 
-Generator::Generator( bool verb, const Mesh& aero_mesh ) :
-  mesh( aero_mesh ), stdclog( clog, verb ), debugstdout( cerr, true )
+template< class Index >
+BasicGenerator< Index >::BasicGenerator( bool              verb,
+                                         const Mesh&       aero_mesh,
+                                         const RealFormat& real_format,
+                                         size_t            threads ) :
+  mesh( aero_mesh ), real_format_( real_format ), threads_( resolve_thread_count( threads ) ),
+  stdclog( clog, verb ), debugstdout( cerr, true )
 {
 }
 
-void Generator::generate( string file_name ) const
+template< class Index >
+void BasicGenerator< Index >::generate( string file_name ) const
 {
-
   stdclog.print( "\nOpening for aero mesh output: ", file_name, "\n" );
 
-  ofstream file;
-  file.open( file_name );
+  OutputBuffer output( file_name );
 
-  if ( !file )
+  if ( !output.is_open( ) )
   {
     stringstream ss;
     ss << "Could not open file " << file_name << " for writing.";
@@ -28,7 +34,86 @@ void Generator::generate( string file_name ) const
     throw runtime_error( ss.str( ) );
   }
 
-  generate( file );
+  write( output );
+}
+
+template< class Index >
+void BasicGenerator< Index >::write( OutputBuffer& output ) const
+{
+  // The mesh is not written if one of these is empty. The attributes are not written but still
+  // checked.
+  if ( mesh.nodes.size( ) == 0 || mesh.elements.empty( ) || mesh.attributes.empty( )
+       || mesh.surface_topologies.empty( ) )
+  {
+    throw runtime_error( "Aero mesh generation failed." );
+  }
+
+  write_begin( output );
+  write_part( output, 0, mesh.elements );
+  write_end( output, mesh.elements.size( ) );
 }
 
+template< class Index >
+void BasicGenerator< Index >::write_begin( OutputBuffer& output ) const
+{
+  if ( mesh.nodes.size( ) == 0 )
+  {
+    throw runtime_error( "Aero mesh generation failed." );
+  }
+
+  write_timed( output, stdclog, "Nodes", [ & ] {
+    write_text( output, "Nodes FluidNodes" );
+    write_nodes( output, threads_, mesh.nodes, real_format_ );
+  } );
+  write_text( output, "\n" );
+  write_text( output, "Elements FluidMesh_0 using FluidNodes" );
+}
+
+template< class Index >
+void BasicGenerator< Index >::write_part( OutputBuffer&                  output,
+                                          size_t                         first,
+                                          const typename Mesh::Elements& elements ) const
+{
+  write_timed( output, stdclog, "Elements", [ & ] {
+    write_elements( output, threads_, elements, first + 1 );
+  } );
+}
+
+template< class Index >
+void BasicGenerator< Index >::write_end( OutputBuffer& output, size_t elements ) const
+{
+  if ( elements == 0 || mesh.attributes.empty( ) || mesh.surface_topologies.empty( ) )
+  {
+    throw runtime_error( "Aero mesh generation failed." );
+  }
+
+  write_text( output, "\n" );
+  write_timed( output, stdclog, "Surfaces", [ & ] {
+    const auto& topologies = mesh.surface_topologies;
+
+    for ( size_t i = 0; i != topologies.size( ); i++ )
+    {
+      const auto& id = topologies[ i ].first;
+
+      if ( i != 0 )
+      {
+        write_text( output, "\n" );
+      }
+      write_text( output,
+            "Elements " + id.first + "Surface_" + to_string( id.second ) + " using FluidNodes" );
+      write_elements( output, threads_, topologies[ i ].second );
+    }
+  } );
+  write_text( output, "\n" );
+
+  output.flush( );
+
+  stdclog.print( "Aero mesh generation completed (", output.size( ) / 1.e6, " MB)." );
+}
+
+template class BasicGenerator< size_t >;
+#ifdef COMSOL2AERO_32BIT_INDICES
+template class BasicGenerator< uint32_t >;
+#endif
+
 } // namespace aerogenerator
@@ -45,12 +45,8 @@
 #include "charstreamer.hpp"
 #include "comsolmesh.hpp"
 #include "config.hpp"
-
-#include <boost/fusion/include/std_pair.hpp>
-#include <boost/spirit/include/karma.hpp>
-#include <boost/spirit/include/karma_real.hpp>
-#include <boost/spirit/include/phoenix_core.hpp>
-#include <boost/spirit/include/phoenix_operator.hpp>
+#include "outputbuffer.hpp"
+#include "realformat.hpp"
 
 #include <array>
 #include <fstream>
@@ -60,123 +56,65 @@
 namespace aerof
 {
 
-using namespace boost::spirit::karma;
-
 using namespace std;
 
 using namespace aero;
 
 using std::string;
 
-// Formatting policy
-template< typename Num >
-struct RealPolicy : real_policies< Num >
-{
-  static int floatfield( Num )
-  {
-    return real_policies< Num >::fmtflags::fixed;
-  }
-
-  static bool trailing_zeros( Num )
-  {
-    return true;
-  }
-
-  static unsigned precision( Num )
-  {
-    return 24;
-  }
-};
-
-// Formatted double generator
-using RealType = real_generator< double, RealPolicy< double > >;
-
-// The core structure of the generator
-template< typename OutputIterator >
-struct GeneratorGrammar : grammar< OutputIterator, Mesh( ) >
-{
-  GeneratorGrammar( ) : GeneratorGrammar::base_type( mesh )
-  {
-
-    mesh = nodes << eol << elements << eol << omit[ attribute_labels ] << omit[ attributes ]
-                 << omit[ matusage ] << topologies << eol;
-
-    nodes %= "Nodes FluidNodes" << eol << eps[ _a = 1 ]
-                                << ( lit( _a ) << eps[ ++_a ] << ' ' << ( real_ % ' ' ) ) % eol;
-
-    elements %= "Elements FluidMesh_0 using FluidNodes"
-                << eol << eps[ _a = 1 ] << ( lit( _a ) << eps[ ++_a ] << ' ' << element ) % eol;
-
-    element = uint_ << ' ' << uint_ % ' ';
-
-    attribute_labels
-      %= ( "* Attributes/matusage labels"
-           << eol << eps[ _a = 1 ]
-           << ( "* " << lit( _a ) << eps[ ++_a ] << ' ' << boost::spirit::karma::string ) % eol )
-         | eps;
-
-    attributes %= "ATTRIBUTES" << eol << eps[ _a = 1 ]
-                               << ( lit( _a ) << eps[ ++_a ] << ' ' << uint_ ) % eol;
-
-    matusage %= "MATUSAGE" << eol << eps[ _a = 1 ]
-                           << ( lit( _a ) << eps[ ++_a ] << ' ' << uint_ ) % eol;
-
-    topologies
-      %= ( topology_id << eol << eps[ _a = 1 ]
-                       << ( lit( _a ) << eps[ ++_a ] << ' ' << ( uint_ << ' ' << uint_ % ' ' ) )
-                            % eol )
-         % eol;
-
-    topology_id = "Elements " << boost::spirit::karma::string << "Surface_" << uint_
-                              << " using FluidNodes";
-  }
-
-  rule< OutputIterator, Mesh( ) >                                      mesh;
-  rule< OutputIterator, locals< size_t >, Mesh::Nodes( ) >             nodes;
-  rule< OutputIterator, locals< size_t >, Mesh::Elements( ) >          elements;
-  rule< OutputIterator, Mesh::Element( ) >                             element;
-  rule< OutputIterator, locals< size_t >, Mesh::AttributeLabels( ) >   attribute_labels;
-  rule< OutputIterator, locals< size_t >, Mesh::Attributes( ) >        attributes;
-  rule< OutputIterator, locals< size_t >, Mesh::Attributes( ) >        matusage;
-  rule< OutputIterator, locals< size_t >, Mesh::SurfaceTopologies( ) > topologies;
-  rule< OutputIterator, Mesh::TopologyId( ) >                          topology_id;
-
-  RealType const real_;
-};
-
-class Generator
+/*! \brief Writes an aero mesh whose node indices are of type Index.
+ *
+ *
+ *  The output is streamed through a fixed size OutputBuffer. Large sections
+ *  are formatted by up to threads threads, the output does not depend on
+ *  the number of threads.
+ */
+template< class Index >
+class BasicGenerator
 {
 
 public:
-  Generator( bool verb, const Mesh& aero_mesh );
+  using Mesh = BasicMesh< Index >;
+
+  BasicGenerator( bool              verb,
+                  const Mesh&       aero_mesh,
+                  const RealFormat& real_format = RealFormat( ),
+                  size_t            threads     = 1 );
 
   void generate( string file_name ) const;
 
   template< class S >
   void generate( S& stream ) const
   {
-    namespace karma = boost::spirit::karma;
-
-    string output_string;
-
-    typedef back_insert_iterator< string > Sink;
-
-    Sink sink( output_string );
+    OutputBuffer output( stream );
 
-    GeneratorGrammar< Sink > g;
+    write( output );
+  }
 
-    if ( !karma::generate( sink, g, mesh ) )
-    {
-      throw runtime_error( "Aero mesh generation failed." );
-    }
+  /*! \brief Writes the mesh in parts, so that its elements can be written
+   *  as they are converted.
+   *
+   *
+   *  write_begin() writes the nodes and the title of the elements, which
+   *  write_part() writes block after block, the first one numbered first + 1.
+   *  write_end(), given the number of elements written, writes the surfaces.
+   *  The nodes of the mesh are only read by write_begin() and its elements
+   *  are not read.
+   */
+  void write_begin( OutputBuffer& output ) const;
 
-    stream << output_string;
+  void write_part( OutputBuffer&                  output,
+                   size_t                         first,
+                   const typename Mesh::Elements& elements ) const;
 
-    stdclog.print( "Aero mesh generation completed." );
-  }
+  void write_end( OutputBuffer& output, size_t elements ) const;
 
 private:
+  void write( OutputBuffer& output ) const;
+
   const Mesh& mesh;
+  RealFormat  real_format_;
+  size_t      threads_;
 
   CharStreamer< ostream > stdclog;
 #ifdef NDEBUG
@@ -186,5 +124,7 @@ private:
 #endif
 };
 
+using Generator = BasicGenerator< size_t >;
+
 } // namespace aero
 #endif // AEROFGENERATOR_H
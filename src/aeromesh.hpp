@@ -41,29 +41,386 @@
 #ifndef AEROMESH_HPP
 #define AEROMESH_HPP
 
+#include "coordinates.hpp"
+#include "span.hpp"
+#include "spillallocator.hpp"
+
 #include <boost/fusion/include/adapt_struct.hpp>
 #define BOOST_SPIRIT_USE_PHOENIX_V3
 #include <boost/fusion/adapted.hpp>
 
-#include <map>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <string>
 #include <utility>
 #include <vector>
 namespace aero
 {
 
-struct Mesh
+/*! \brief View of one element of an ElementList: its type id and its nodes.
+ */
+template< typename Index >
+struct ElementView
 {
-  using Node                       = std::vector< double >;
-  using Nodes                      = std::vector< Node >;
-  using Connectivity               = std::vector< std::size_t >;
-  using Element                    = std::pair< std::size_t, Connectivity >;
-  using Elements                   = std::vector< Element >;
+  std::size_t         type;
+  Span< const Index > nodes;
+};
+
+/*! \brief Flat storage of elements of possibly different node counts.
+ *
+ *
+ *  The node indices of all elements are kept in one array. Elements are
+ *  appended in runs of one type id and node count, e.g. one per element
+ *  set, and only the runs are recorded, so the list takes little more than
+ *  its node indices. Appending an element does not allocate once the list
+ *  has been reserved.
+ */
+template< typename Index >
+class ElementList
+{
+  //! Elements of one type id and node count, consecutive in the list
+  struct Run
+  {
+    std::size_t type;
+    std::size_t node_count;
+    std::size_t first_element;
+    std::size_t first_node;
+  };
+
+public:
+  using Element = ElementView< Index >;
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = Element;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const Element*;
+    using reference         = Element;
+
+    const_iterator( ) = default;
+
+    //! Iterator to element i, the run of which is searched once
+    const_iterator( const ElementList* list, std::size_t i ) :
+      list_( list ), i_( i ), run_( list->run_of( i ) )
+    {
+    }
+
+    Element operator*( ) const
+    {
+      return list_->element( run_, i_ );
+    }
+
+    const_iterator& operator++( )
+    {
+      if ( ++i_ == list_->end_of( run_ ) )
+      {
+        ++run_;
+      }
+      return *this;
+    }
+
+    const_iterator operator++( int )
+    {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==( const const_iterator& other ) const
+    {
+      return i_ == other.i_;
+    }
+
+    bool operator!=( const const_iterator& other ) const
+    {
+      return i_ != other.i_;
+    }
+
+  private:
+    const ElementList* list_ = nullptr;
+    std::size_t        i_    = 0;
+    std::size_t        run_  = 0;
+  };
+
+  using value_type      = Element;
+  using size_type       = std::size_t;
+  using reference       = Element;
+  using const_reference = Element;
+  using iterator        = const_iterator;
+
+  //! Reserves the storage of nodes node indices, the elements need none
+  void reserve( std::size_t /*elements*/, std::size_t nodes )
+  {
+    nodes_.reserve( nodes );
+  }
+
+  /*! \brief Appends count elements of type id type and node_count nodes each.
+   *
+   *  Returns the storage of the new element nodes, one element after the
+   *  other, valid until the next append.
+   */
+  Span< Index > push_back( std::size_t type, std::size_t node_count, std::size_t count = 1 )
+  {
+    const std::size_t first = nodes_.size( );
+
+    add_run( type, node_count, count );
+    nodes_.resize( first + count * node_count );
+
+    return Span< Index >( nodes_.data( ) + first, count * node_count );
+  }
+
+  /*! \brief Appends the elements of type id type whose nodes, node_count per
+   *  element, are stored in nodes.
+   *
+   *  An empty list takes over the storage of nodes instead of copying it.
+   *  Returns the storage of the new element nodes, as above.
+   */
+  Span< Index > push_back( std::size_t type, std::size_t node_count, SpillVector< Index >&& nodes )
+  {
+    const std::size_t count = node_count != 0 ? nodes.size( ) / node_count : 0;
+
+    if ( !empty( ) )
+    {
+      auto to = push_back( type, node_count, count );
+      std::copy( nodes.begin( ), nodes.begin( ) + count * node_count, to.data( ) );
+      return to;
+    }
+
+    add_run( type, node_count, count );
+
+    nodes_ = std::move( nodes );
+    nodes_.resize( count * node_count );
+
+    return Span< Index >( nodes_.data( ), nodes_.size( ) );
+  }
+
+  //! Appends all the elements of other, run by run
+  void append( const ElementList& other )
+  {
+    for ( std::size_t r = 0; r != other.runs_.size( ); r++ )
+    {
+      const Run&        run   = other.runs_[ r ];
+      const std::size_t count = other.end_of( r ) - run.first_element;
+      const auto        first = other.nodes_.begin( ) + run.first_node;
+
+      add_run( run.type, run.node_count, count );
+      nodes_.insert( nodes_.end( ), first, first + count * run.node_count );
+    }
+  }
+
+  std::size_t size( ) const
+  {
+    return size_;
+  }
+
+  bool empty( ) const
+  {
+    return size_ == 0;
+  }
+
+  Element operator[]( std::size_t i ) const
+  {
+    return element( run_of( i ), i );
+  }
+
+  const_iterator begin( ) const
+  {
+    return const_iterator( this, 0 );
+  }
+
+  const_iterator end( ) const
+  {
+    return const_iterator( this, size( ) );
+  }
+
+private:
+  // Appends count elements to the last run, or to a new one if their type or node count differ
+  void add_run( std::size_t type, std::size_t node_count, std::size_t count )
+  {
+    if ( count == 0 )
+    {
+      return;
+    }
+    if ( runs_.empty( ) || runs_.back( ).type != type || runs_.back( ).node_count != node_count )
+    {
+      runs_.push_back( Run { type, node_count, size_, nodes_.size( ) } );
+    }
+    size_ += count;
+  }
+
+  // Run of element i, runs_.size() if i is past the end
+  std::size_t run_of( std::size_t i ) const
+  {
+    const auto after = std::upper_bound(
+      runs_.begin( ), runs_.end( ), i, [ & ]( std::size_t element, const Run& run ) {
+        return element < run.first_element;
+      } );
+
+    return i < size_ ? static_cast< std::size_t >( after - runs_.begin( ) ) - 1 : runs_.size( );
+  }
+
+  // First element after run r
+  std::size_t end_of( std::size_t r ) const
+  {
+    return r + 1 < runs_.size( ) ? runs_[ r + 1 ].first_element : size_;
+  }
+
+  Element element( std::size_t r, std::size_t i ) const
+  {
+    const Run& run = runs_[ r ];
+
+    return Element { run.type,
+                     Span< const Index >(
+                       nodes_.data( ) + run.first_node + ( i - run.first_element ) * run.node_count,
+                       run.node_count ) };
+  }
+
+  std::vector< Run >   runs_; // One per element set, in order
+  SpillVector< Index > nodes_;
+  std::size_t          size_ = 0;
+};
+
+/*! \brief References to several ElementList, iterated as one list.
+ *
+ *
+ *  Used to present faces that already belong to a surface topology without
+ *  copying them: the runs of the lists follow each other. The referenced
+ *  lists must outlive the view.
+ */
+template< typename Index >
+class ElementListView
+{
+public:
+  using Element = ElementView< Index >;
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = Element;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const Element*;
+    using reference         = Element;
+
+    const_iterator( ) = default;
+
+    const_iterator( const ElementListView* view, std::size_t list ) : view_( view ), list_( list )
+    {
+      skip_empty( );
+    }
+
+    Element operator*( ) const
+    {
+      return *element_;
+    }
+
+    const_iterator& operator++( )
+    {
+      if ( ++element_ == view_->lists_[ list_ ]->end( ) )
+      {
+        ++list_;
+        skip_empty( );
+      }
+      return *this;
+    }
+
+    const_iterator operator++( int )
+    {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==( const const_iterator& other ) const
+    {
+      return list_ == other.list_ && element_ == other.element_;
+    }
+
+    bool operator!=( const const_iterator& other ) const
+    {
+      return !( *this == other );
+    }
+
+  private:
+    // Moves to the first element of the next list that has any, or to the end
+    void skip_empty( )
+    {
+      while ( list_ != view_->lists_.size( ) && view_->lists_[ list_ ]->empty( ) )
+      {
+        ++list_;
+      }
+      element_ = list_ != view_->lists_.size( ) ? view_->lists_[ list_ ]->begin( )
+                                                : typename ElementList< Index >::const_iterator( );
+    }
+
+    const ElementListView*                        view_ = nullptr;
+    std::size_t                                   list_ = 0;
+    typename ElementList< Index >::const_iterator element_;
+  };
+
+  using value_type      = Element;
+  using size_type       = std::size_t;
+  using reference       = Element;
+  using const_reference = Element;
+  using iterator        = const_iterator;
+
+  void push_back( const ElementList< Index >& list )
+  {
+    lists_.push_back( &list );
+    size_ += list.size( );
+  }
+
+  //! Total number of elements
+  std::size_t size( ) const
+  {
+    return size_;
+  }
+
+  bool empty( ) const
+  {
+    return size_ == 0;
+  }
+
+  const_iterator begin( ) const
+  {
+    return const_iterator( this, 0 );
+  }
+
+  const_iterator end( ) const
+  {
+    return const_iterator( this, lists_.size( ) );
+  }
+
+private:
+  std::vector< const ElementList< Index >* > lists_;
+  std::size_t                                size_ = 0;
+};
+
+/*! \brief The aero mesh.
+ *
+ *
+ *  Index is the integer type that stores node indices and attributes.
+ *  Selection surface topologies reference the faces of surface_topologies,
+ *  hence the mesh can be moved but not copied.
+ */
+template< typename Index >
+struct BasicMesh
+{
+  using IndexType                  = Index;
+  using Node                       = Coordinates::Point;
+  using Nodes                      = Coordinates; // Shares the comsol mesh point buffer
+  using Connectivity               = Span< const Index >;
+  using Element                    = ElementView< Index >;
+  using Elements                   = ElementList< Index >;
   using AttributeLabels            = std::vector< std::string >;
-  using Attributes                 = std::vector< std::size_t >;
+  using Attributes                 = SpillVector< Index >;
   using TopologyId                 = std::pair< std::string, std::size_t >;
-  using SurfaceTopologies          = std::map< TopologyId, Elements >;
-  using SelectionSurfaceTopology   = std::pair< std::string, Elements >;
+  using SurfaceTopology            = std::pair< TopologyId, Elements >;
+  using SurfaceTopologies          = std::vector< SurfaceTopology >; // Sorted by TopologyId
+  using SelectionSurfaceTopology   = std::pair< std::string, ElementListView< Index > >;
   using SelectionSurfaceTopologies = std::vector< SelectionSurfaceTopology >;
 
   Nodes                      nodes;
@@ -72,19 +429,34 @@ struct Mesh
   Attributes                 attributes;
   SurfaceTopologies          surface_topologies;
   SelectionSurfaceTopologies selection_surface_topologies;
+
+  BasicMesh( ) = default;
+
+  BasicMesh( const BasicMesh& ) = delete;
+  BasicMesh( BasicMesh&& )      = default;
+
+  BasicMesh& operator=( const BasicMesh& ) = delete;
+  BasicMesh& operator=( BasicMesh&& ) = default;
 };
 
+using Mesh = BasicMesh< std::size_t >;
+
 } // namespace aero
 
 // clang-format off
-BOOST_FUSION_ADAPT_STRUCT( aero::Mesh,
-  ( aero::Mesh::Nodes,                      nodes )
-  ( aero::Mesh::Elements,                   elements )
-  ( aero::Mesh::AttributeLabels,            attribute_labels )
-  ( aero::Mesh::Attributes,                 attributes )
-  ( aero::Mesh::Attributes,                 attributes ) // Repeating in case the user wants to output matusage
-  ( aero::Mesh::SurfaceTopologies,          surface_topologies )
-  ( aero::Mesh::SelectionSurfaceTopologies, selection_surface_topologies )
+BOOST_FUSION_ADAPT_TPL_STRUCT( ( Index ), ( aero::ElementView )( Index ),
+  ( std::size_t,         type )
+  ( Span< const Index >, nodes )
+)
+
+BOOST_FUSION_ADAPT_TPL_STRUCT( ( Index ), ( aero::BasicMesh )( Index ),
+  ( typename aero::BasicMesh< Index >::Nodes,                      nodes )
+  ( typename aero::BasicMesh< Index >::Elements,                   elements )
+  ( typename aero::BasicMesh< Index >::AttributeLabels,            attribute_labels )
+  ( typename aero::BasicMesh< Index >::Attributes,                 attributes )
+  ( typename aero::BasicMesh< Index >::Attributes,                 attributes ) // Repeating in case the user wants to output matusage
+  ( typename aero::BasicMesh< Index >::SurfaceTopologies,          surface_topologies )
+  ( typename aero::BasicMesh< Index >::SelectionSurfaceTopologies, selection_surface_topologies )
 )
 // clang-format on
 
@@ -1,4 +1,5 @@
 #include "aerosgenerator.hpp"
+#include "sectionwriter.hpp"
 #include "utils.hpp"
 #include <iomanip>
 #include <memory>
@@ -7,19 +8,25 @@
 namespace aeros
 {
 
-Generator::Generator( bool verb, bool matusage, const Mesh& aero_mesh ) :
-  mesh( aero_mesh ), stdclog( clog, verb ), debugstdout( cerr, true ), matusage_( matusage )
+template< class Index >
+BasicGenerator< Index >::BasicGenerator( bool              verb,
+                                         bool              matusage,
+                                         const Mesh&       aero_mesh,
+                                         const RealFormat& real_format,
+                                         size_t            threads ) :
+  mesh( aero_mesh ), matusage_( matusage ), real_format_( real_format ),
+  threads_( resolve_thread_count( threads ) ), stdclog( clog, verb ), debugstdout( cerr, true )
 {
 }
 
-void Generator::generate( string file_name ) const
+template< class Index >
+void BasicGenerator< Index >::generate( string file_name ) const
 {
   stdclog.print( "\nOpening for aero mesh output: ", file_name, "\n" );
 
-  ofstream file;
-  file.open( file_name );
+  OutputBuffer output( file_name );
 
-  if ( !file )
+  if ( !output.is_open( ) )
   {
     stringstream ss;
     ss << "Could not open file " << file_name << " for writing.";
@@ -27,7 +34,152 @@ void Generator::generate( string file_name ) const
     throw runtime_error( ss.str( ) );
   }
 
-  generate( file );
+  write( output );
 }
 
+namespace
+{
+// Generates one section of the grammar, which must succeed
+template< class Sink, class Generator, class... Attributes >
+void section( Sink& sink, const Generator& generator, const Attributes&... attribute )
+{
+  if ( !boost::spirit::karma::generate( sink, generator, attribute... ) )
+  {
+    throw runtime_error( "Aero mesh generation failed." );
+  }
+}
+} // namespace
+
+template< class Index >
+void BasicGenerator< Index >::write( OutputBuffer& output ) const
+{
+  // Lists fail on empty containers, so does the whole mesh if one of these is empty
+  if ( mesh.nodes.size( ) == 0 || mesh.elements.empty( ) || mesh.attributes.empty( ) )
+  {
+    throw runtime_error( "Aero mesh generation failed." );
+  }
+
+  write_begin( output );
+  write_part( output, 0, mesh.elements );
+  write_end( output, mesh.elements.size( ) );
+}
+
+template< class Index >
+void BasicGenerator< Index >::write_begin( OutputBuffer& output ) const
+{
+  using Sink = OutputBuffer::iterator;
+
+  if ( mesh.nodes.size( ) == 0 )
+  {
+    throw runtime_error( "Aero mesh generation failed." );
+  }
+
+  Sink                            sink( output );
+  GeneratorGrammar< Sink, Index > g;
+
+  section( sink, g.header );
+  write_timed( output, stdclog, "NODES", [ & ] {
+    write_text( output, "NODES" );
+    write_nodes( output, threads_, mesh.nodes, real_format_ );
+  } );
+  section( sink, g.separator );
+  write_text( output, "TOPOLOGY" );
+}
+
+template< class Index >
+void BasicGenerator< Index >::write_part( OutputBuffer&                  output,
+                                          size_t                         first,
+                                          const typename Mesh::Elements& elements ) const
+{
+  write_timed( output, stdclog, "TOPOLOGY", [ & ] {
+    write_elements( output, threads_, elements, first + 1 );
+  } );
+}
+
+template< class Index >
+void BasicGenerator< Index >::write_end( OutputBuffer& output, size_t elements ) const
+{
+  using Sink = OutputBuffer::iterator;
+
+  if ( elements == 0 || mesh.attributes.empty( ) )
+  {
+    throw runtime_error( "Aero mesh generation failed." );
+  }
+
+  Sink                            sink( output );
+  GeneratorGrammar< Sink, Index > g;
+
+  section( sink, g.separator );
+  section( sink, g.attribute_labels, mesh.attribute_labels );
+  section( sink, g.separator );
+  write_timed( output, stdclog, "ATTRIBUTES", [ & ] {
+    write_text( output, "ATTRIBUTES" );
+    write_values( output, threads_, mesh.attributes );
+  } );
+  section( sink, g.separator );
+
+  if ( matusage_ )
+  {
+    write_timed( output, stdclog, "MATUSAGE", [ & ] {
+      write_text( output, "MATUSAGE" );
+      write_values( output, threads_, mesh.attributes );
+    } );
+    section( sink, g.separator );
+  }
+
+  section( sink, g.topologies, mesh.surface_topologies );
+  section( sink, g.separator );
+
+  // A selection without faces is written as its title only, and only when a later selection is
+  // written. Nothing is written when all the selections are empty.
+  const auto& selections = mesh.selection_surface_topologies;
+
+  const auto next_written = [ & ]( size_t i ) {
+    while ( i != selections.size( ) && selections[ i ].second.empty( ) )
+    {
+      i++;
+    }
+    return i;
+  };
+
+  write_timed( output, stdclog, "SURFACETOPO", [ & ] {
+    size_t written = next_written( 0 );
+
+    if ( written == selections.size( ) )
+    {
+      return;
+    }
+
+    for ( size_t i = 0;; )
+    {
+      for ( ; i <= written; i++ )
+      {
+        write_text( output,
+              "SURFACETOPO " + to_string( i + 1 ) + " * Selection name: " + selections[ i ].first );
+        write_elements( output, selections[ i ].second );
+        write_text( output, "\n" );
+      }
+
+      written = next_written( written + 1 );
+
+      if ( written == selections.size( ) )
+      {
+        break;
+      }
+      write_text( output, "\n" );
+    }
+    write_text( output, "*" );
+  } );
+  section( sink, eol );
+
+  output.flush( );
+
+  stdclog.print( "Aero mesh generation completed (", output.size( ) / 1.e6, " MB)." );
+}
+
+template class BasicGenerator< size_t >;
+#ifdef COMSOL2AERO_32BIT_INDICES
+template class BasicGenerator< uint32_t >;
+#endif
+
 } // namespace aerogenerator
@@ -45,10 +45,11 @@
 #include "charstreamer.hpp"
 #include "comsolmesh.hpp"
 #include "config.hpp"
+#include "outputbuffer.hpp"
+#include "realformat.hpp"
 
 #include <boost/fusion/include/std_pair.hpp>
 #include <boost/spirit/include/karma.hpp>
-#include <boost/spirit/include/karma_real.hpp>
 #include <boost/spirit/include/karma_string.hpp>
 #include <boost/spirit/include/phoenix_core.hpp>
 #include <boost/spirit/include/phoenix_operator.hpp>
@@ -69,49 +70,22 @@ using namespace aero;
 
 using std::string;
 
-// Formatting policy
-template< typename Num >
-struct RealPolicy : real_policies< Num >
+/*! \brief The sections of an aero-s mesh.
+ *
+ *
+ *  BasicGenerator generates the sections one at a time, so that the output
+ *  can be streamed. The integer sections are written by sectionwriter.hpp.
+ */
+template< typename OutputIterator, typename Index = size_t >
+struct GeneratorGrammar : grammar< OutputIterator >
 {
-  static int floatfield( Num )
-  {
-    return real_policies< Num >::fmtflags::fixed;
-  }
+  using Mesh = BasicMesh< Index >;
 
-  static bool trailing_zeros( Num )
+  GeneratorGrammar( ) : GeneratorGrammar::base_type( header )
   {
-    return true;
-  }
-
-  static unsigned precision( Num )
-  {
-    return 24;
-  }
-};
-
-// Formatted double generator
-using RealType = real_generator< double, RealPolicy< double > >;
-
-// The core structure of the generator
-template< typename OutputIterator >
-struct GeneratorGrammar : grammar< OutputIterator, Mesh( ) >
-{
-  GeneratorGrammar( bool generate_matusage ) : GeneratorGrammar::base_type( mesh )
-  {
-
-    mesh = "* Created with comsol2aero version "
-           << lit( VERSION ) << eol << '*' << eol << nodes << eol << '*' << eol << elements << eol
-           << '*' << eol << attribute_labels << eol << '*' << eol << attributes << eol << '*'
-           << eol << ( ( eps( generate_matusage == true ) << matusage << eol << '*' << eol ) | eps )
-           << topologies << eol << '*' << eol << selection_topologies << eol;
-
-    nodes %= "NODES" << eol << eps[ _a = 1 ]
-                     << ( lit( _a ) << eps[ ++_a ] << ' ' << ( real_ % ' ' ) ) % eol;
+    header = "* Created with comsol2aero version " << lit( VERSION ) << eol << '*' << eol;
 
-    elements %= "TOPOLOGY" << eol << eps[ _a = 1 ]
-                           << ( lit( _a ) << eps[ ++_a ] << ' ' << element ) % eol;
-
-    element = uint_ << ' ' << uint_ % ' ';
+    separator = eol << '*' << eol;
 
     attribute_labels
       %= ( "* Attributes/matusage labels"
@@ -119,12 +93,6 @@ struct GeneratorGrammar : grammar< OutputIterator, Mesh( ) >
            << ( "* " << lit( _a ) << eps[ ++_a ] << ' ' << boost::spirit::karma::string ) % eol )
          | eps;
 
-    attributes %= "ATTRIBUTES" << eol << eps[ _a = 1 ]
-                               << ( lit( _a ) << eps[ ++_a ] << ' ' << uint_ ) % eol;
-
-    matusage %= "MATUSAGE" << eol << eps[ _a = 1 ]
-                           << ( lit( _a ) << eps[ ++_a ] << ' ' << uint_ ) % eol;
-
     topologies %= ( "SURFACETOPO "
                     << topology_id << eol << eps[ _a = 1 ]
                     << ( lit( _a ) << eps[ ++_a ] << ' ' << ( uint_ << ' ' << uint_ % ' ' ) ) % eol
@@ -133,69 +101,70 @@ struct GeneratorGrammar : grammar< OutputIterator, Mesh( ) >
                   | eps;
 
     topology_id = omit[ boost::spirit::karma::string ] << uint_;
-
-    selection_topologies %= eps[ _a = 1 ] << ( "SURFACETOPO " << lit( _a ) << eps[ ++_a ] << ' '
-                                                              << selection_topology << eol )
-                                               % eol
-                                          << '*'
-                            | eps;
-
-    selection_topology
-      %= "* Selection name: " << boost::spirit::karma::string << eol << eps[ _a = 1 ]
-                              << ( lit( _a ) << eps[ ++_a ] << ' ' << element ) % eol;
   }
 
-  rule< OutputIterator, Mesh( ) >                                      mesh;
-  rule< OutputIterator, locals< size_t >, Mesh::Nodes( ) >             nodes;
-  rule< OutputIterator, locals< size_t >, Mesh::Elements( ) >          elements;
-  rule< OutputIterator, Mesh::Element( ) >                             element;
-  rule< OutputIterator, locals< size_t >, Mesh::AttributeLabels( ) >   attribute_labels;
-  rule< OutputIterator, locals< size_t >, Mesh::Attributes( ) >        attributes;
-  rule< OutputIterator, locals< size_t >, Mesh::Attributes( ) >        matusage;
-  rule< OutputIterator, locals< size_t >, Mesh::SurfaceTopologies( ) > topologies;
-  rule< OutputIterator, Mesh::TopologyId( ) >                          topology_id;
-
-  rule< OutputIterator, locals< size_t >, Mesh::SelectionSurfaceTopologies( ) >
-                                                                              selection_topologies;
-  rule< OutputIterator, locals< size_t >, Mesh::SelectionSurfaceTopology( ) > selection_topology;
-
-  RealType const real_;
+  rule< OutputIterator >                                                        header;
+  rule< OutputIterator >                                                        separator;
+  rule< OutputIterator, locals< size_t >, typename Mesh::AttributeLabels( ) >   attribute_labels;
+  rule< OutputIterator, locals< size_t >, typename Mesh::SurfaceTopologies( ) > topologies;
+  rule< OutputIterator, typename Mesh::TopologyId( ) >                          topology_id;
 };
 
-class Generator
+/*! \brief Writes an aero mesh whose node indices are of type Index.
+ *
+ *
+ *  The output is streamed through a fixed size OutputBuffer. Large sections
+ *  are formatted by up to threads threads, the output does not depend on
+ *  the number of threads.
+ */
+template< class Index >
+class BasicGenerator
 {
 
 public:
-  Generator( bool verb, bool matusage, const Mesh& aero_mesh );
+  using Mesh = BasicMesh< Index >;
+
+  BasicGenerator( bool              verb,
+                  bool              matusage,
+                  const Mesh&       aero_mesh,
+                  const RealFormat& real_format = RealFormat( ),
+                  size_t            threads     = 1 );
 
   void generate( string file_name ) const;
 
   template< class S >
   void generate( S& stream ) const
   {
-    namespace karma = boost::spirit::karma;
-
-    string output_string;
+    OutputBuffer output( stream );
 
-    typedef back_insert_iterator< string > Sink;
-
-    Sink sink( output_string );
-
-    GeneratorGrammar< Sink > g( matusage_ );
+    write( output );
+  }
 
-    if ( !karma::generate( sink, g, mesh ) )
-    {
-      throw runtime_error( "Aero mesh generation failed." );
-    }
+  /*! \brief Writes the mesh in parts, so that its elements can be written
+   *  as they are converted.
+   *
+   *
+   *  write_begin() writes the sections up to the title of the elements, which
+   *  write_part() writes block after block, the first one numbered first + 1.
+   *  write_end(), given the number of elements written, writes the rest of
+   *  the mesh. The nodes of the mesh are only read by write_begin() and its
+   *  elements are not read.
+   */
+  void write_begin( OutputBuffer& output ) const;
 
-    stream << output_string;
+  void write_part( OutputBuffer&                  output,
+                   size_t                         first,
+                   const typename Mesh::Elements& elements ) const;
 
-    stdclog.print( "Aero mesh generation completed." );
-  }
+  void write_end( OutputBuffer& output, size_t elements ) const;
 
 private:
+  void write( OutputBuffer& output ) const;
+
   const Mesh& mesh;
   bool        matusage_;
+  RealFormat  real_format_;
+  size_t      threads_;
 
   CharStreamer< ostream > stdclog;
 #ifdef NDEBUG
@@ -205,5 +174,7 @@ private:
 #endif
 };
 
+using Generator = BasicGenerator< size_t >;
+
 } // namespace aero
 #endif // AEROSGENERATOR_H
@@ -0,0 +1,40 @@
+#include "allocationcounter.hpp"
+
+#ifdef COMSOL2AERO_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic< std::size_t > allocations( 0 );
+}
+
+void* operator new( std::size_t size )
+{
+  allocations.fetch_add( 1, std::memory_order_relaxed );
+
+  if ( void* p = std::malloc( size != 0 ? size : 1 ) )
+  {
+    return p;
+  }
+  throw std::bad_alloc( );
+}
+
+void operator delete( void* p ) noexcept
+{
+  std::free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+  std::free( p );
+}
+
+std::size_t allocation_count( )
+{
+  return allocations.load( std::memory_order_relaxed );
+}
+
+#endif
@@ -0,0 +1,237 @@
+#include "batch.hpp"
+#include "charstreamer.hpp"
+#include "conversion.hpp"
+#include "parallel.hpp"
+
+#include <boost/program_options/parsers.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <glob.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+
+struct Job
+{
+  UserOptions options;
+  string      description; // Input and output file names
+};
+
+bool has_wildcards( const string& name )
+{
+  return name.find_first_of( "*?[" ) != string::npos;
+}
+
+// File names matching pattern, sorted
+vector< string > matching_files( const string& pattern )
+{
+  vector< string > files;
+
+#ifndef _MSC_VER
+  glob_t found;
+
+  if ( glob( pattern.c_str( ), 0, nullptr, &found ) == 0 )
+  {
+    files.assign( found.gl_pathv, found.gl_pathv + found.gl_pathc );
+  }
+  globfree( &found );
+#endif
+
+  return files;
+}
+
+// File name without its directory and extension
+string stem( const string& name )
+{
+  const auto slash = name.find_last_of( "/\\" );
+  const auto base  = name.substr( slash != string::npos ? slash + 1 : 0 );
+
+  return base.substr( 0, base.rfind( '.' ) );
+}
+
+void replace_all( string& s, const string& from, const string& to )
+{
+  for ( auto i = s.find( from ); i != string::npos; i = s.find( from, i + to.size( ) ) )
+  {
+    s.replace( i, from.size( ), to );
+  }
+}
+
+Job make_job( const vector< string >& args )
+{
+  Job job;
+
+  job.options     = parse_batch_job_options( args );
+  job.description = job.options.input_file_name + " ->";
+
+  job.options.message_prefix = job.options.input_file_name + ": ";
+
+  for ( const auto& target : job.options.outputs )
+  {
+    job.description += " " + target.file_name;
+  }
+  return job;
+}
+
+// Jobs of the line of a batch file, one for every file matching a wildcard input file name
+vector< Job > read_jobs( const string& line )
+{
+  const vector< string > args  = boost::program_options::split_unix( line );
+  const Job              first = make_job( args );
+  const string&          input = first.options.input_file_name;
+
+  if ( !has_wildcards( input ) )
+  {
+    return { first };
+  }
+
+  const auto files = matching_files( input );
+
+  if ( files.empty( ) )
+  {
+    throw runtime_error( "No file matches " + input + "." );
+  }
+
+  vector< Job > jobs;
+
+  for ( const auto& file : files )
+  {
+    vector< string > job_args;
+
+    for ( auto arg : args )
+    {
+      if ( arg == input )
+      {
+        arg = file;
+      }
+      replace_all( arg, "{}", stem( file ) );
+      job_args.push_back( arg );
+    }
+    jobs.push_back( make_job( job_args ) );
+  }
+  return jobs;
+}
+
+vector< Job > read_batch( const string& file_name )
+{
+  ifstream file( file_name );
+
+  if ( !file.is_open( ) )
+  {
+    throw runtime_error( "Could not open batch file " + file_name + "." );
+  }
+
+  vector< Job > jobs;
+  string        line;
+
+  for ( size_t number = 1; getline( file, line ); number++ )
+  {
+    const auto first = line.find_first_not_of( " \t\r" );
+
+    if ( first == string::npos || line[ first ] == '#' )
+    {
+      continue;
+    }
+
+    try
+    {
+      for ( auto& job : read_jobs( line ) )
+      {
+        jobs.push_back( std::move( job ) );
+      }
+    }
+    catch ( exception& e )
+    {
+      stringstream ss;
+      ss << "Batch file " << file_name << ", line " << number << ": " << e.what( );
+
+      throw runtime_error( ss.str( ) );
+    }
+  }
+  return jobs;
+}
+
+double file_size( const string& file_name )
+{
+  ifstream file( file_name, ios::binary | ios::ate );
+
+  return file.is_open( ) ? static_cast< double >( file.tellg( ) ) : 0.;
+}
+
+} // namespace
+
+bool run_batch( const UserOptions& options )
+{
+  CharStreamer< ostream > stdclog( clog, options.verbose );
+
+  const auto jobs = read_batch( options.batch_file_name );
+
+  stdclog.print( "Batch of ", jobs.size( ), " jobs from ", options.batch_file_name );
+
+  mutex  report_mutex;
+  size_t completed = 0;
+  size_t failed    = 0;
+  double bytes     = 0;
+
+  const auto start = chrono::steady_clock::now( );
+
+  parallel_for( resolve_thread_count( options.threads ), jobs.size( ), [ & ]( size_t i ) {
+    const Job& job = jobs[ i ];
+
+    const auto job_start = chrono::steady_clock::now( );
+
+    string error;
+
+    try
+    {
+      convert( job.options );
+    }
+    catch ( exception& e )
+    {
+      error = e.what( );
+    }
+    catch ( ... )
+    {
+      error = "Exception of unknown type!";
+    }
+
+    const chrono::duration< double > elapsed = chrono::steady_clock::now( ) - job_start;
+    const double                     size    = file_size( job.options.input_file_name );
+
+    lock_guard< mutex > lock( report_mutex );
+
+    completed++;
+    cout << "[" << completed << "/" << jobs.size( ) << "] " << job.description << ": ";
+
+    if ( error.empty( ) )
+    {
+      bytes += size;
+      cout << elapsed.count( ) << " s, " << size / 1.e6 / elapsed.count( ) << " MB/s" << endl;
+    }
+    else
+    {
+      failed++;
+      cout << "failed: " << error << endl;
+    }
+  } );
+
+  const chrono::duration< double > elapsed = chrono::steady_clock::now( ) - start;
+
+  cout << "Converted " << jobs.size( ) - failed << " of " << jobs.size( ) << " jobs, "
+       << bytes / 1.e6 << " MB in " << elapsed.count( ) << " s: " << bytes / 1.e6 / elapsed.count( )
+       << " MB/s" << endl;
+
+  return failed == 0;
+}
@@ -0,0 +1,671 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef BLOCKPARSERS_HPP
+#define BLOCKPARSERS_HPP
+
+#include "comsolmesh.hpp"
+#include "parallel.hpp"
+
+#include <boost/spirit/include/qi.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace comsol
+{
+
+namespace qi = boost::spirit::qi;
+
+namespace detail
+{
+
+template< typename Iterator >
+constexpr bool is_contiguous_v = std::is_pointer< Iterator >::value;
+
+inline bool is_blank( char c )
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// Skips white space inline and falls back to the grammar skipper for comments.
+template< typename Iterator, typename Skipper >
+void skip( Iterator& first, const Iterator& last, const Skipper& skipper )
+{
+  while ( first != last && is_blank( *first ) )
+  {
+    ++first;
+  }
+  if ( first != last && *first == '#' )
+  {
+    qi::skip_over( first, last, skipper );
+  }
+}
+
+/*! \brief Locale independent, correctly rounded scanning of a real number.
+ *
+ *
+ *  Contiguous ranges are handed directly to std::from_chars (an Eisel-Lemire
+ *  implementation in current standard libraries). Other iterators copy the
+ *  token to a small buffer first. The first iterator is advanced only on
+ *  success.
+ */
+template< typename Iterator >
+bool scan_real( Iterator& first, const Iterator& last, double& value )
+{
+#ifdef __cpp_lib_to_chars
+  if constexpr ( is_contiguous_v< Iterator > )
+  {
+    const char* begin = first;
+    if ( begin != last && *begin == '+' ) // Not accepted by from_chars
+    {
+      ++begin;
+    }
+    auto result = std::from_chars( begin, last, value );
+    if ( result.ec != std::errc( ) || result.ptr == begin )
+    {
+      return false;
+    }
+    first = result.ptr;
+    return true;
+  }
+  else
+  {
+    constexpr std::size_t max_token = 64;
+
+    char        buffer[ max_token ];
+    std::size_t size = 0;
+    Iterator    iter = first;
+
+    if ( iter != last && *iter == '+' )
+    {
+      ++iter;
+    }
+    Iterator begin = iter;
+
+    while ( iter != last && size != max_token && !is_blank( *iter ) && *iter != '#' )
+    {
+      buffer[ size++ ] = *iter++;
+    }
+
+    if ( size == max_token ) // Unusually long token, let spirit handle it
+    {
+      return qi::parse( first, last, qi::double_, value );
+    }
+
+    auto result = std::from_chars( buffer, buffer + size, value );
+    if ( result.ec != std::errc( ) || result.ptr == buffer )
+    {
+      return false;
+    }
+    std::advance( begin, result.ptr - buffer );
+    first = begin;
+    return true;
+  }
+#else
+  return qi::parse( first, last, qi::double_, value );
+#endif
+}
+
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || defined( _MSC_VER )
+#define COMSOL2AERO_SWAR_DIGITS
+#endif
+
+#ifdef COMSOL2AERO_SWAR_DIGITS
+// Number of leading decimal digits in 8 characters loaded little endian.
+inline unsigned swar_digit_count( std::uint64_t chunk )
+{
+  const std::uint64_t high = 0xF0F0F0F0F0F0F0F0ull;
+  const std::uint64_t ascii_digit = 0x3030303030303030ull;
+
+  // Non zero bytes mark non digits: the high nibble must be 3 both before and after adding 6.
+  std::uint64_t non_digit
+    = ( ( chunk & high ) ^ ascii_digit ) | ( ( ( chunk + 0x0606060606060606ull ) & high ) ^ ascii_digit );
+
+  if ( non_digit == 0 )
+  {
+    return 8;
+  }
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64( &index, non_digit );
+  return index / 8;
+#else
+  return static_cast< unsigned >( __builtin_ctzll( non_digit ) ) / 8;
+#endif
+}
+
+// Value of 8 digit characters loaded little endian (first character most significant).
+inline std::uint64_t swar_digits_value( std::uint64_t chunk )
+{
+  chunk = ( chunk & 0x0F0F0F0F0F0F0F0Full ) * 2561 >> 8;
+  chunk = ( chunk & 0x00FF00FF00FF00FFull ) * 6553601 >> 16;
+  return ( chunk & 0x0000FFFF0000FFFFull ) * 42949672960001ull >> 32;
+}
+#endif
+
+/*! \brief Scanning of an unsigned decimal integer without floating point conversion.
+ *
+ *
+ *  For contiguous ranges with enough input left, digits are classified and
+ *  converted eight at a time (SWAR). Values that do not fit T fail the scan.
+ *  The first iterator is advanced only on success.
+ */
+template< typename Iterator, typename T >
+bool scan_index( Iterator& first, const Iterator& last, T& value )
+{
+  static_assert( std::is_unsigned< T >::value, "Indices are unsigned" );
+
+  constexpr std::uint64_t max = std::numeric_limits< T >::max( );
+
+  Iterator      iter   = first;
+  std::uint64_t result = 0;
+  std::size_t   digits = 0;
+
+#ifdef COMSOL2AERO_SWAR_DIGITS
+  if constexpr ( is_contiguous_v< Iterator > )
+  {
+    // Two rounds cover 16 digits which always fit 64 bits.
+    for ( int round = 0; round != 2 && last - iter >= 8; round++ )
+    {
+      std::uint64_t chunk;
+      std::memcpy( &chunk, iter, 8 );
+
+      unsigned count = swar_digit_count( chunk );
+      if ( count == 0 )
+      {
+        break;
+      }
+
+      static constexpr std::uint64_t pow10[ 9 ]
+        = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+      result = result * pow10[ count ] + swar_digits_value( chunk << ( 8 * ( 8 - count ) ) );
+      digits += count;
+      iter += count;
+
+      if ( count != 8 )
+      {
+        break;
+      }
+    }
+  }
+#endif
+
+  for ( ; iter != last && static_cast< unsigned char >( *iter - '0' ) < 10; ++iter, ++digits )
+  {
+    std::uint64_t d = static_cast< unsigned char >( *iter - '0' );
+    if ( result > ( max - d ) / 10 )
+    {
+      return false;
+    }
+    result = result * 10 + d;
+  }
+
+  if ( digits == 0 || result > max )
+  {
+    return false;
+  }
+
+  value = static_cast< T >( result );
+  first = iter;
+  return true;
+}
+
+/*! \brief Locates the lines of a block of count records written one per line.
+ *
+ *
+ *  Blank lines and lines starting with a comment are not records. The start of
+ *  every step-th record (first non blank character of its line) is appended to
+ *  starts. Returns false if the input ends before count records are found.
+ */
+inline bool record_lines( const char*                  first,
+                          const char*                  last,
+                          size_t                       count,
+                          size_t                       step,
+                          std::vector< const char* >& starts )
+{
+  const char* p = first;
+
+  for ( size_t k = 0; k != count; )
+  {
+    while ( p != last && is_blank( *p ) )
+    {
+      ++p;
+    }
+    if ( p == last )
+    {
+      return false;
+    }
+    if ( *p != '#' )
+    {
+      if ( k % step == 0 )
+      {
+        starts.push_back( p );
+      }
+      k++;
+    }
+
+    p = static_cast< const char* >( std::memchr( p, '\n', last - p ) );
+    p = p ? p + 1 : last;
+  }
+  return true;
+}
+
+/*! \brief Locates the object sections of a mesh file.
+ *
+ *
+ *  Objects are preceded by a "# --------- Object N ----------" comment line.
+ *  Returns the start of every such line in order. The input is searched
+ *  concurrently in large pieces.
+ */
+inline std::vector< const char* > object_sections( const char* first, const char* last, size_t threads )
+{
+  static const std::string_view marker = "# --------- Object ";
+
+  const size_t size   = static_cast< size_t >( last - first );
+  const size_t pieces = std::max< size_t >( 1, std::min( 4 * threads, size >> 24 ) );
+  const size_t piece  = size / pieces + 1;
+
+  std::vector< std::vector< const char* > > found( pieces );
+
+  parallel_for( threads, pieces, [ & ]( size_t i ) {
+    const size_t begin = std::min( size, i * piece );
+    const size_t end   = std::min( size, begin + piece + marker.size( ) - 1 ); // Overlap
+
+    std::string_view text( first + begin, end - begin );
+
+    for ( size_t pos = text.find( marker ); pos != std::string_view::npos;
+          pos        = text.find( marker, pos + 1 ) )
+    {
+      const char* p = text.data( ) + pos;
+      if ( p - first >= static_cast< std::ptrdiff_t >( begin + piece ) ) // Next piece's match
+      {
+        break;
+      }
+      if ( p == first || p[ -1 ] == '\n' || p[ -1 ] == '\r' )
+      {
+        found[ i ].push_back( p );
+      }
+    }
+  } );
+
+  std::vector< const char* > sections;
+  for ( const auto& f : found )
+  {
+    sections.insert( sections.end( ), f.begin( ), f.end( ) );
+  }
+  return sections;
+}
+
+} // namespace detail
+
+/*! \brief Base of the parsers of the large numeric blocks of a mesh file.
+ *
+ *
+ *  A block consists of count records of a fixed number of values. The block
+ *  sizes are stored in the grammar and are known only at parse time, hence
+ *  derived parsers keep references to them. Derived classes implement:
+ *
+ *    size_t count( ), size_t values( )
+ *    void allocate( Attribute&, size_t records )
+ *    bool parse_record( iter, last, skipper, Attribute&, size_t record )
+ *
+ *  Large blocks of contiguous inputs are split in newline aligned chunks that
+ *  are parsed concurrently directly into their final slots. Every chunk must
+ *  end where the next one starts, otherwise (i.e. records not written one per
+ *  line, or a syntax error) the block is parsed serially. Hence results and
+ *  errors are always the ones of the serial parser.
+ */
+template< typename Derived, typename Attribute >
+struct BlockParser : qi::primitive_parser< Derived >
+{
+  static constexpr size_t min_chunk_records = 1 << 14;
+
+  template< typename Context, typename Iterator >
+  struct attribute
+  {
+    typedef Attribute type;
+  };
+
+  BlockParser( size_t threads ) : threads_( threads )
+  {
+  }
+
+  template< typename Iterator, typename Context, typename Skipper, typename Attr >
+  bool parse( Iterator& first, const Iterator& last, Context&, const Skipper& skipper, Attr& attr )
+    const
+  {
+    if constexpr ( std::is_same< std::remove_const_t< Attr >, boost::spirit::unused_type >::value )
+    {
+      Attribute unused;
+      return parse_block( first, last, skipper, unused );
+    }
+    else
+    {
+      return parse_block( first, last, skipper, attr );
+    }
+  }
+
+  template< typename Iterator, typename Skipper >
+  bool parse_block( Iterator& first, const Iterator& last, const Skipper& skipper, Attribute& attr )
+    const
+  {
+    const size_t count    = derived( ).count( );
+    size_t       capacity = 0; // Records allocated
+
+    attr.clear( );
+
+    if constexpr ( detail::is_contiguous_v< Iterator > )
+    {
+      // Every value takes at least two characters (a digit and a separator)
+      const size_t values = std::max< size_t >( derived( ).values( ), 1 );
+      if ( count > static_cast< size_t >( last - first ) / ( 2 * values ) + 1 )
+      {
+        return false;
+      }
+      derived( ).allocate( attr, count );
+      capacity = count;
+
+      if ( threads_ > 1 && count >= 2 * min_chunk_records
+           && parse_chunks( first, last, skipper, attr ) )
+      {
+        return true;
+      }
+    }
+
+    Iterator iter = first;
+
+    for ( size_t i = 0; i != count; i++ )
+    {
+      if ( i == capacity ) // Storage of non contiguous inputs grows on demand
+      {
+        capacity = std::min( count, std::max< size_t >( 2 * i, 1 << 16 ) );
+        derived( ).allocate( attr, capacity );
+      }
+      if ( !derived( ).parse_record( iter, last, skipper, attr, i ) )
+      {
+        return false;
+      }
+    }
+
+    first = iter;
+    return true;
+  }
+
+  template< typename Skipper >
+  bool parse_chunks( const char*&   first,
+                     const char*    last,
+                     const Skipper& skipper,
+                     Attribute&     attr ) const
+  {
+    const size_t count  = derived( ).count( );
+    const size_t chunks = std::min( 4 * threads_, count / min_chunk_records );
+    const size_t step   = ( count + chunks - 1 ) / chunks;
+
+    std::vector< const char* > starts;
+    starts.reserve( chunks );
+
+    if ( !detail::record_lines( first, last, count, step, starts ) )
+    {
+      return false;
+    }
+
+    std::vector< const char* > ends( starts.size( ) );
+
+    parallel_for( threads_, starts.size( ), [ & ]( size_t c ) {
+      const char* iter = starts[ c ];
+      const size_t end = std::min( count, ( c + 1 ) * step );
+
+      for ( size_t i = c * step; i != end; i++ )
+      {
+        if ( !derived( ).parse_record( iter, last, skipper, attr, i ) )
+        {
+          return; // ends[ c ] stays null
+        }
+      }
+
+      ends[ c ] = iter;
+      if ( c + 1 != starts.size( ) )
+      {
+        detail::skip( iter, last, skipper );
+        if ( iter != starts[ c + 1 ] )
+        {
+          ends[ c ] = nullptr;
+        }
+      }
+    } );
+
+    if ( std::find( ends.begin( ), ends.end( ), nullptr ) != ends.end( ) )
+    {
+      return false;
+    }
+
+    first = ends.back( );
+    return true;
+  }
+
+  const Derived& derived( ) const
+  {
+    return static_cast< const Derived& >( *this );
+  }
+
+  size_t threads_;
+};
+
+/*! \brief Parses the mesh point coordinate block.
+ *
+ *
+ *  Parses count points of sdim coordinates each.
+ */
+struct CoordinateBlockParser : BlockParser< CoordinateBlockParser, Coordinates >
+{
+  CoordinateBlockParser( const size_t& sdim, const size_t& count, size_t threads = 1 ) :
+    BlockParser( threads ), sdim_( sdim ), count_( count )
+  {
+  }
+
+  size_t count( ) const
+  {
+    return count_;
+  }
+
+  size_t values( ) const
+  {
+    return sdim_;
+  }
+
+  void allocate( Coordinates& coords, size_t records ) const
+  {
+    coords.resize( sdim_, records );
+  }
+
+  template< typename Iterator, typename Skipper >
+  bool parse_record( Iterator&       iter,
+                     const Iterator& last,
+                     const Skipper&  skipper,
+                     Coordinates&    coords,
+                     size_t          i ) const
+  {
+    for ( size_t d = 0; d != sdim_; d++ )
+    {
+      detail::skip( iter, last, skipper );
+
+      if ( !detail::scan_real( iter, last, coords( i, d ) ) )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template< typename Context >
+  boost::spirit::info what( Context& ) const
+  {
+    return boost::spirit::info( "coordinate block" );
+  }
+
+  const size_t& sdim_;
+  const size_t& count_;
+};
+
+/*! \brief Parses the element connectivity block.
+ *
+ *
+ *  Parses count elements of a fixed number of nodes each into a flat array.
+ *  Node indices are read as integers of type Index.
+ */
+template< typename Index >
+struct ElementBlockParser :
+  BlockParser< ElementBlockParser< Index >, typename BasicElementSet< Index >::Connectivity >
+{
+  using Connectivity = typename BasicElementSet< Index >::Connectivity;
+
+  ElementBlockParser( const size_t& nodes, const size_t& count, size_t threads = 1 ) :
+    BlockParser< ElementBlockParser, Connectivity >( threads ), nodes_( nodes ), count_( count )
+  {
+  }
+
+  size_t count( ) const
+  {
+    return count_;
+  }
+
+  size_t values( ) const
+  {
+    return nodes_;
+  }
+
+  void allocate( Connectivity& connectivity, size_t records ) const
+  {
+    connectivity.resize( records * nodes_ );
+  }
+
+  template< typename Iterator, typename Skipper >
+  bool parse_record( Iterator&       iter,
+                     const Iterator& last,
+                     const Skipper&  skipper,
+                     Connectivity&   connectivity,
+                     size_t          i ) const
+  {
+    auto element = connectivity.begin( ) + i * nodes_;
+
+    for ( size_t k = 0; k != nodes_; k++ )
+    {
+      detail::skip( iter, last, skipper );
+
+      if ( !detail::scan_index( iter, last, element[ k ] ) )
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template< typename Context >
+  boost::spirit::info what( Context& ) const
+  {
+    return boost::spirit::info( "element block" );
+  }
+
+  const size_t& nodes_;
+  const size_t& count_;
+};
+
+/*! \brief Parses a block of count indices (i.e. geometric entity indices)
+ *  into a container of Index.
+ */
+template< typename Index = size_t, class Indices = vector< Index > >
+struct IndexBlockParser : BlockParser< IndexBlockParser< Index, Indices >, Indices >
+{
+  IndexBlockParser( const size_t& count, size_t threads = 1 ) :
+    BlockParser< IndexBlockParser, Indices >( threads ), count_( count )
+  {
+  }
+
+  size_t count( ) const
+  {
+    return count_;
+  }
+
+  size_t values( ) const
+  {
+    return 1;
+  }
+
+  void allocate( Indices& indices, size_t records ) const
+  {
+    indices.resize( records );
+  }
+
+  template< typename Iterator, typename Skipper >
+  bool parse_record( Iterator&       iter,
+                     const Iterator& last,
+                     const Skipper&  skipper,
+                     Indices&        indices,
+                     size_t          i ) const
+  {
+    detail::skip( iter, last, skipper );
+
+    return detail::scan_index( iter, last, indices[ i ] );
+  }
+
+  template< typename Context >
+  boost::spirit::info what( Context& ) const
+  {
+    return boost::spirit::info( "index block" );
+  }
+
+  const size_t& count_;
+};
+
+} // namespace comsol
+
+#endif // BLOCKPARSERS_HPP
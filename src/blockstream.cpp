@@ -0,0 +1,113 @@
+#include "blockstream.hpp"
+#include "spillallocator.hpp"
+
+void BlockStream::Deallocate::operator( )( char* data ) const noexcept
+{
+  spill_deallocate( data, block_size );
+}
+
+BlockStream::BlockStream( std::istream& stream ) : stream_( stream )
+{
+  reader_ = std::thread( &BlockStream::read, this );
+}
+
+BlockStream::~BlockStream( )
+{
+  {
+    std::lock_guard< std::mutex > lock( mutex_ );
+    stop_ = true;
+  }
+  reader_.join( );
+}
+
+void BlockStream::read( )
+{
+  std::streambuf* buf = stream_.rdbuf( );
+
+  for ( ;; )
+  {
+    std::unique_ptr< char[], Deallocate > data;
+
+    try
+    {
+      data.reset( static_cast< char* >( spill_allocate( block_size ) ) );
+    }
+    catch ( ... )
+    {
+      std::lock_guard< std::mutex > lock( mutex_ );
+
+      error_ = std::current_exception( );
+      eof_   = true;
+      available_.notify_all( );
+      return;
+    }
+
+    std::size_t size = 0;
+    while ( size != block_size )
+    {
+      auto count = buf->sgetn( data.get( ) + size, block_size - size );
+      if ( count <= 0 )
+      {
+        break;
+      }
+      size += static_cast< std::size_t >( count );
+    }
+
+    std::lock_guard< std::mutex > lock( mutex_ );
+
+    if ( size != 0 )
+    {
+      blocks_.push_back( Block { std::move( data ), size } );
+    }
+
+    if ( size != block_size || stop_ )
+    {
+      eof_ = true;
+    }
+
+    available_.notify_all( );
+
+    if ( eof_ )
+    {
+      return;
+    }
+  }
+}
+
+bool BlockStream::wait_for( std::size_t i, const char*& first, const char*& last )
+{
+  std::unique_lock< std::mutex > lock( mutex_ );
+
+  available_.wait( lock, [ & ] { return blocks_.size( ) > i || eof_; } );
+
+  if ( blocks_.size( ) <= i )
+  {
+    if ( error_ )
+    {
+      std::rethrow_exception( error_ );
+    }
+    return false;
+  }
+
+  first = blocks_[ i ].data.get( );
+  last  = first + blocks_[ i ].size;
+  return true;
+}
+
+BlockStream::const_iterator BlockStream::begin( )
+{
+  const_iterator iter;
+  iter.stream_ = this;
+
+  wait_for( 0, iter.cur_, iter.block_end_ );
+
+  return iter;
+}
+
+void BlockStream::next_block( const_iterator& iter )
+{
+  if ( wait_for( iter.block_ + 1, iter.cur_, iter.block_end_ ) )
+  {
+    ++iter.block_;
+  }
+}
@@ -0,0 +1,181 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef BLOCKSTREAM_HPP
+#define BLOCKSTREAM_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! \brief Concurrent block reader for non seekable inputs.
+ *
+ *
+ *  A background thread reads the stream in large blocks while the consumer
+ *  (the parser) iterates over the data already available. Iterators block
+ *  only when they reach the end of the data read so far, which lets parsing
+ *  overlap with a slow producer (i.e. a decompressing pipe).
+ *
+ *  Blocks are retained until the BlockStream is destroyed, hence iterators
+ *  remain valid and can be freely copied and backtracked by the parser.
+ *  They are allocated with spill_allocate, so that they count against the
+ *  memory limit and are mapped from temporary files beyond it, like the
+ *  mesh arrays.
+ */
+class BlockStream
+{
+  struct Deallocate
+  {
+    void operator( )( char* data ) const noexcept;
+  };
+
+  struct Block
+  {
+    std::unique_ptr< char[], Deallocate > data;
+    std::size_t                           size;
+  };
+
+public:
+  static constexpr std::size_t block_size = 4 * 1024 * 1024;
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = char;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const char*;
+    using reference         = const char&;
+
+    const_iterator( ) = default; // End of stream sentinel
+
+    reference operator*( ) const
+    {
+      return *cur_;
+    }
+
+    pointer operator->( ) const
+    {
+      return cur_;
+    }
+
+    const_iterator& operator++( )
+    {
+      if ( ++cur_ == block_end_ )
+      {
+        stream_->next_block( *this );
+      }
+      return *this;
+    }
+
+    const_iterator operator++( int )
+    {
+      const_iterator tmp( *this );
+      ++*this;
+      return tmp;
+    }
+
+    // Iterators are kept normalized: they point past the end of their block only at the end of
+    // the stream.
+    friend bool operator==( const const_iterator& a, const const_iterator& b )
+    {
+      if ( a.stream_ == nullptr || b.stream_ == nullptr )
+      {
+        return ( a.cur_ == a.block_end_ ) == ( b.cur_ == b.block_end_ );
+      }
+      return a.cur_ == b.cur_;
+    }
+
+    friend bool operator!=( const const_iterator& a, const const_iterator& b )
+    {
+      return !( a == b );
+    }
+
+  private:
+    friend class BlockStream;
+
+    const char*  cur_       = nullptr;
+    const char*  block_end_ = nullptr;
+    std::size_t  block_     = 0;
+    BlockStream* stream_    = nullptr;
+  };
+
+  BlockStream( std::istream& stream );
+  ~BlockStream( );
+
+  BlockStream( const BlockStream& ) = delete;
+  BlockStream& operator=( const BlockStream& ) = delete;
+
+  const_iterator begin( );
+
+  const_iterator end( ) const
+  {
+    return const_iterator( );
+  }
+
+private:
+  void read( );
+
+  // Moves the iterator to the start of the block following its current one, waiting for the
+  // block to be read if needed. The iterator is left at the end of its block on end of stream.
+  void next_block( const_iterator& iter );
+
+  // Waits for block i to become available and returns its range. Returns false, leaving the
+  // range untouched, if the stream ended before it. Throws what reading it threw.
+  bool wait_for( std::size_t i, const char*& first, const char*& last );
+
+  std::istream& stream_;
+
+  std::vector< Block >    blocks_;
+  bool                    eof_  = false;
+  bool                    stop_ = false;
+  std::exception_ptr      error_; // Of the reader, e.g. out of memory
+  std::mutex              mutex_;
+  std::condition_variable available_;
+
+  std::thread reader_;
+};
+
+#endif // BLOCKSTREAM_HPP
@@ -43,6 +43,8 @@
 
 #include "utils.hpp"
 
+#include <sstream>
+
 template< class S >
 class CharStreamer
 {
@@ -61,7 +63,11 @@ public:
   {
     if ( active_ )
     {
-      safe_print( stream_, args..., '\n' );
+      // One insertion per message, so that messages printed from concurrent threads do not
+      // interleave
+      std::ostringstream line;
+      safe_print( line, args..., '\n' );
+      stream_ << line.str( );
     }
   }
 
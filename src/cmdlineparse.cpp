@@ -8,6 +8,7 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
 #include <exception>
 #include <iostream>
 #include <stdexcept>
@@ -176,7 +177,11 @@ struct Hex : public MappingOption< Hex >
 
 template void validate< Hex >( boost::any& v, const std::vector< std::string >&, Hex*, int );
 
-UserOptions parse_command_line_options( int ac, char* av[] )
+namespace
+{
+
+// Options of the command line, or of one job of a batch file if batch_job
+UserOptions parse_options( po::command_line_parser&& parser, bool batch_job )
 {
 
   UserOptions options;
@@ -206,7 +211,8 @@ UserOptions parse_command_line_options( int ac, char* av[] )
     "comsol2aero barmesh_dense.mphtxt -o barmesh.top --tet 5 --tri 4 -e -n InletFixed StickFixed "
     "StickFixed StickFixed StickFixed OutletFixed\n"
     "comsol2aero selections.mphtxt -o selections.geom -s \"Center Mat 1\" \"Center Mat 2\" "
-    "\"Surrounding\""
+    "\"Surrounding\"\n"
+    "comsol2aero comsolmesh.mphtxt --aero-s-output aero.top --aero-f-output aero.fluid"
     "\nAllowed options" );
 
   desc.add_options( )( "help,h", "produce help message" )
@@ -248,7 +254,58 @@ UserOptions parse_command_line_options( int ac, char* av[] )
                              "mode." )
 
                 ( "verbose,v",
-                  "verbose mode. Messages are streamed to std::clog (and hence stderr)." );
+                  "verbose mode. Messages are streamed to std::clog (and hence stderr)." )
+
+                  ( "threads,t",
+                    po::value< std::size_t >( &options.threads )->default_value( 0 ),
+                    "number of threads used to process large meshes. 0 uses all available "
+                    "hardware threads. Results do not depend on the number of threads." )
+
+                    ( "precision",
+                      po::value< std::string >( )->default_value( "fixed" ),
+                      "format of the node coordinates: fixed (16 decimals), shortest (shortest "
+                      "representation that reads back exactly) or N (N significant digits, 1 to "
+                      "17)." )
+
+                      ( "aero-s-output",
+                        po::value< std::string >( ),
+                        "aero-s output file name. Together with --aero-f-output both meshes are "
+                        "generated concurrently from one conversion. Not allowed with -o "
+                        "[ --output ] or -e [ --aero-f ]." )
+
+                        ( "aero-f-output",
+                          po::value< std::string >( ),
+                          "aero-f output file name. See --aero-s-output." )
+
+                          ( "pipeline",
+                            "parse, convert and generate concurrently, writing the nodes and "
+                            "elements while the rest of the input is parsed. Applies to an input "
+                            "file and a single output, otherwise the stages run one after the "
+                            "other." )
+
+                            ( "memory-limit",
+                              po::value< std::size_t >( &options.memory_limit )->default_value( 0 ),
+                              "memory in MB the large mesh arrays, and the input read from the "
+                              "standard input, may take. Beyond it they are mapped from temporary "
+                              "files in the directory of --spill-dir, so that larger meshes are "
+                              "converted at the speed of the disk. 0 sets no limit." )
+
+                              ( "spill-dir",
+                                po::value< std::string >( &options.spill_directory ),
+                                "directory of the temporary files of --memory-limit, TMPDIR (or "
+                                "/tmp) by default. It must be on a disk: a directory held in "
+                                "memory, like a tmpfs /tmp, saves no memory and is warned about." )
+
+                                ( "batch",
+                                  po::value< std::string >( ),
+                                  "convert the jobs listed in the given file concurrently. Each "
+                                  "line holds the options of one job as on the command line, input "
+                                  "file name and output file names included. An input file name "
+                                  "with wildcards (*, ? or [...]) adds a job for every matching "
+                                  "file, with {} in the other options replaced by its name without "
+                                  "directory and extension. Empty lines and lines starting with # "
+                                  "are skipped. Only -v, -t, --memory-limit and --spill-dir are "
+                                  "allowed besides." );
 
   Tri   triv;
   auto  texttr = triv.help_text( );
@@ -279,7 +336,7 @@ UserOptions parse_command_line_options( int ac, char* av[] )
   all.add( desc ).add( hidden );
 
   po::variables_map vm;
-  po::store( po::command_line_parser( ac, av ).options( all ).positional( p ).run( ), vm );
+  po::store( parser.options( all ).positional( p ).run( ), vm );
   po::notify( vm );
 
   if ( vm.count( "verbose" ) )
@@ -299,16 +356,45 @@ UserOptions parse_command_line_options( int ac, char* av[] )
 
   options.accepted_selections = vm[ "selections" ].as< std::vector< std::string > >( );
 
+  if ( vm.count( "aero-s-output" ) || vm.count( "aero-f-output" ) )
+  {
+    if ( options.aerof || vm.count( "output" ) )
+    {
+      throw std::invalid_argument( "--aero-s-output and --aero-f-output are not allowed with -o "
+                                   "[ --output ] or -e [ --aero-f ]." );
+    }
+
+    if ( vm.count( "aero-s-output" ) )
+    {
+      options.outputs.push_back( { false, vm[ "aero-s-output" ].as< string >( ) } );
+    }
+    if ( vm.count( "aero-f-output" ) )
+    {
+      options.outputs.push_back( { true, vm[ "aero-f-output" ].as< string >( ) } );
+    }
+
+    if ( options.outputs.size( ) == 2
+         && options.outputs[ 0 ].file_name == options.outputs[ 1 ].file_name )
+    {
+      throw std::invalid_argument( "The aero-s and aero-f output file names must differ." );
+    }
+  }
+
+  const bool aerof_output = std::any_of(
+    options.outputs.begin( ), options.outputs.end( ), []( const auto& t ) { return t.aerof; } );
+
   if ( !vm[ "names" ].empty( ) )
   {
 
-    if ( options.aerof == false )
+    if ( options.aerof == false && !aerof_output )
     {
       throw std::invalid_argument( "-n [ --names ] option is allowed only aero-f mode." );
     }
     options.surface_name_prefixes = vm[ "names" ].as< std::vector< std::string > >( );
   }
 
+  options.real_format = parse_real_format( vm[ "precision" ].as< std::string >( ) );
+
   if ( vm.count( "force" ) )
   {
     if ( !options.verbose )
@@ -324,7 +410,30 @@ UserOptions parse_command_line_options( int ac, char* av[] )
     options.matusage = true;
   }
 
-  CharStreamer< std::ostream > stdclog( std::clog, options.verbose );
+  if ( vm.count( "pipeline" ) )
+  {
+    options.pipeline = true;
+  }
+
+  if ( batch_job )
+  {
+    if ( vm.count( "help" ) || vm.count( "version" ) || vm.count( "batch" )
+         || !vm[ "memory-limit" ].defaulted( ) || vm.count( "spill-dir" ) )
+    {
+      throw std::invalid_argument( "-h [ --help ], -r [ --version ], --batch, --memory-limit and "
+                                   "--spill-dir are not allowed in a batch job." );
+    }
+    if ( !vm.count( "input" ) )
+    {
+      throw std::invalid_argument( "A batch job needs an input file name." );
+    }
+    if ( !vm.count( "output" ) && options.outputs.empty( ) )
+    {
+      throw std::invalid_argument( "A batch job needs an output file name." );
+    }
+  }
+
+  CharStreamer< std::ostream > stdclog( std::clog, options.verbose && !batch_job );
 
   stdclog.print( "Comsol to Aero v.", VERSION, ". Built: ", __TIME__, ", ", __DATE__ );
 
@@ -434,7 +543,26 @@ UserOptions parse_command_line_options( int ac, char* av[] )
     return options;
   }
 
-  bool piped = ( !IsStdinAtty( ) );
+  if ( vm.count( "batch" ) )
+  {
+    const char* allowed[] = { "batch", "verbose", "threads", "memory-limit", "spill-dir" };
+
+    for ( const auto& option : vm )
+    {
+      if ( !option.second.defaulted( )
+           && std::find( std::begin( allowed ), std::end( allowed ), option.first )
+                == std::end( allowed ) )
+      {
+        throw std::invalid_argument( "Only -v [ --verbose ], -t [ --threads ], --memory-limit "
+                                     "and --spill-dir are allowed with --batch, found --"
+                                     + option.first + "." );
+      }
+    }
+    options.batch_file_name = vm[ "batch" ].as< string >( );
+    return options;
+  }
+
+  bool piped = !batch_job && !IsStdinAtty( );
 
   if ( vm.count( "input" ) )
   {
@@ -466,12 +594,26 @@ UserOptions parse_command_line_options( int ac, char* av[] )
         "file." );
     }
   }
+  else if ( !options.outputs.empty( ) )
+  {
+    if ( options.force )
+    {
+      throw std::invalid_argument(
+        "-f [ --force ] option has no effect and is not allowed when the output targets are "
+        "files." );
+    }
+  }
   else if ( options.verbose && !options.force )
   {
     throw std::invalid_argument(
       "When an output filename is not specified run with -f to force verbose output to stderr." );
   }
 
+  if ( options.outputs.empty( ) )
+  {
+    options.outputs.push_back( { options.aerof, options.output_file_name } );
+  }
+
   options.element_mapping[ "tri" ] = triv.value;
   options.element_mapping[ "tet" ] = tetv.value;
   // options.elementMapping[ "tet_50_96_103" ] = tetv.value;
@@ -481,3 +623,15 @@ UserOptions parse_command_line_options( int ac, char* av[] )
 
   return options;
 }
+
+} // namespace
+
+UserOptions parse_command_line_options( int ac, char* av[] )
+{
+  return parse_options( po::command_line_parser( ac, av ), false );
+}
+
+UserOptions parse_batch_job_options( const std::vector< std::string >& args )
+{
+  return parse_options( po::command_line_parser( args ), true );
+}
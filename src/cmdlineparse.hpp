@@ -41,10 +41,23 @@
 #ifndef CMDLINEPARSE_HPP
 #define CMDLINEPARSE_HPP
 
+#include "realformat.hpp"
+
 #include <map>
 #include <string>
 #include <vector>
 
+/*! \brief An aero mesh to generate from the converted mesh.
+ *
+ *
+ *  An empty file name writes to the standard output.
+ */
+struct OutputTarget
+{
+  bool        aerof = false;
+  std::string file_name;
+};
+
 struct UserOptions
 {
   bool                                 verbose         = false;
@@ -54,8 +67,16 @@ struct UserOptions
   bool                                 aerof           = false;
   bool                                 matusage        = false;
   bool                                 use_selections  = false;
+  bool                                 pipeline        = false;
+  std::size_t                          threads         = 0;
+  std::size_t                          memory_limit    = 0; // MB, 0 for none
+  RealFormat                           real_format;
   std::string                          input_file_name;
   std::string                          output_file_name;
+  std::string                          batch_file_name;
+  std::string                          spill_directory; // Empty for TMPDIR or /tmp
+  std::string                          message_prefix; // Starts warnings, names a batch job
+  std::vector< OutputTarget >          outputs;
   std::map< std::string, std::size_t > element_mapping;
   std::vector< std::string >           surface_name_prefixes;
   std::vector< std::string >           accepted_selections;
@@ -63,4 +84,13 @@ struct UserOptions
 
 UserOptions parse_command_line_options( int ac, char* av[] );
 
+/*! \brief Options of one job of a batch file, args being its command line
+ *  arguments.
+ *
+ *
+ *  A job has an input and output file names, neither can be a standard
+ *  stream.
+ */
+UserOptions parse_batch_job_options( const std::vector< std::string >& args );
+
 #endif // PARSECOMMANDLINE_HPP
@@ -41,11 +41,18 @@
 #ifndef COMSOLMODEL_HPP
 #define COMSOLMODEL_HPP
 
+#include "coordinates.hpp"
+#include "span.hpp"
+#include "spillallocator.hpp"
+
 #include <boost/fusion/include/adapt_struct.hpp>
 
+#include <cstdint>
+#include <limits>
 #include <map>
 #include <string>
 #include <utility>
+#include <variant>
 #include <vector>
 
 namespace comsol
@@ -56,37 +63,56 @@ using namespace std;
 // postfix Type conveys the semantic type and not the C++ type.
 // Element is the C++ type that represents a finite element.
 
-struct ElementSet
+/*! \brief Element connectivity and geometric indices of one element type.
+ *
+ *
+ *  Index is the integer type that stores node and geometric entity indices.
+ */
+template< typename Index >
+struct BasicElementSet
 {
+  using IndexType         = Index;
   using ElementType       = pair< size_t, string >;
-  using Element           = vector< size_t >;
-  using Elements          = vector< Element >;
-  using GeometricIndicies = vector< size_t >;
+  using Element           = Span< const Index >;
+  using Connectivity      = SpillVector< Index >; // nodes_per_element indices per element
+  using GeometricIndicies = SpillVector< Index >;
 
   ElementType       element_type;
-  Elements          elements;
+  size_t            nodes_per_element = 0;
+  Connectivity      connectivity;
   GeometricIndicies geometric_indicies;
+
+  //! Number of elements
+  size_t size( ) const
+  {
+    return nodes_per_element != 0 ? connectivity.size( ) / nodes_per_element : 0;
+  }
+
+  Element operator[]( size_t i ) const
+  {
+    return Element( connectivity.data( ) + i * nodes_per_element, nodes_per_element );
+  }
 };
 
 } // namespace comsol
 
 // clang-format off
-BOOST_FUSION_ADAPT_STRUCT( comsol::ElementSet,
-  ( comsol::ElementSet::ElementType,       element_type )
-  ( comsol::ElementSet::Elements,          elements )
-  ( comsol::ElementSet::GeometricIndicies, geometric_indicies ) )
+BOOST_FUSION_ADAPT_TPL_STRUCT( ( Index ), ( comsol::BasicElementSet )( Index ),
+  ( typename comsol::BasicElementSet< Index >::ElementType,       element_type )
+  ( size_t,                                                       nodes_per_element )
+  ( typename comsol::BasicElementSet< Index >::Connectivity,      connectivity )
+  ( typename comsol::BasicElementSet< Index >::GeometricIndicies, geometric_indicies ) )
 // clang-format on
 
 namespace comsol
 {
 
-struct MeshObject
+template< typename Index >
+struct BasicMeshObject
 {
-  using ElementSets = vector< ElementSet >;
-  using Point       = vector< double >; // FIXME: We could possibly restrict
-                                        // this to 2 or 3 dim arrays, but
-                                        // performance gains may be minimal.
-  using Coords = vector< Point >;
+  using ElementSets = vector< BasicElementSet< Index > >;
+  using Point       = Coordinates::Point;
+  using Coords      = Coordinates; // One contiguous buffer for all points
 
   size_t class_id;
 
@@ -104,14 +130,14 @@ struct MeshObject
 } // namespace comsol
 
 // clang-format off
-BOOST_FUSION_ADAPT_STRUCT( comsol::MeshObject,
-  ( size_t,                          class_id )
-  ( size_t,                          version )
-  ( size_t,                          space_dimensions )
-  ( size_t,                          num_mesh_points )
-  ( size_t,                          index0 )
-  ( comsol::MeshObject::Coords,      coordinates )
-  ( comsol::MeshObject::ElementSets, element_sets )
+BOOST_FUSION_ADAPT_TPL_STRUCT( ( Index ), ( comsol::BasicMeshObject )( Index ),
+  ( size_t,                                                 class_id )
+  ( size_t,                                                 version )
+  ( size_t,                                                 space_dimensions )
+  ( size_t,                                                 num_mesh_points )
+  ( size_t,                                                 index0 )
+  ( typename comsol::BasicMeshObject< Index >::Coords,      coordinates )
+  ( typename comsol::BasicMeshObject< Index >::ElementSets, element_sets )
 )
 // clang-format on
 
@@ -144,8 +170,11 @@ BOOST_FUSION_ADAPT_STRUCT( comsol::SelectionObject,
 namespace comsol
 {
 
-struct Mesh
+template< typename Index >
+struct BasicMesh
 {
+  using IndexType = Index;
+
   using Version = pair< size_t, size_t >;
 
   using Tag  = pair< size_t, string >;
@@ -156,24 +185,55 @@ struct Mesh
 
   using SelectionObjects = vector< SelectionObject >;
 
-  string           created;
-  Version          version;
-  Tags             tags;
-  Types            types;
-  MeshObject       object;
-  SelectionObjects selection_object;
+  string                   created;
+  Version                  version;
+  Tags                     tags;
+  Types                    types;
+  BasicMeshObject< Index > object;
+  SelectionObjects         selection_object;
 };
 
 } // namespace comsol
 
 // clang-format off
-BOOST_FUSION_ADAPT_STRUCT( comsol::Mesh,
-  ( std::string,                    created )
-  ( comsol::Mesh::Version,          version )
-  ( comsol::Mesh::Tags,             tags )
-  ( comsol::Mesh::Types,            types )
-  ( comsol::MeshObject,             object )
-  ( comsol::Mesh::SelectionObjects, selection_object )
+BOOST_FUSION_ADAPT_TPL_STRUCT( ( Index ), ( comsol::BasicMesh )( Index ),
+  ( std::string,                                           created )
+  ( typename comsol::BasicMesh< Index >::Version,          version )
+  ( typename comsol::BasicMesh< Index >::Tags,             tags )
+  ( typename comsol::BasicMesh< Index >::Types,            types )
+  ( comsol::BasicMeshObject< Index >,                      object )
+  ( typename comsol::BasicMesh< Index >::SelectionObjects, selection_object )
 )
 // clang-format on
+
+namespace comsol
+{
+
+using ElementSet = BasicElementSet< size_t >;
+using MeshObject = BasicMeshObject< size_t >;
+using Mesh       = BasicMesh< size_t >;
+
+/*! \brief A mesh stored with any of the supported index widths.
+ *
+ *
+ *  Meshes whose node indices fit in 32 bits are stored with 32 bit indices,
+ *  halving the size of the connectivity arrays. The 32 bit storage can be
+ *  disabled at build time with COMSOL2AERO_32BIT_INDICES.
+ */
+#ifdef COMSOL2AERO_32BIT_INDICES
+using AnyMesh = variant< BasicMesh< size_t >, BasicMesh< uint32_t > >;
+#else
+using AnyMesh = variant< BasicMesh< size_t > >;
+#endif
+
+//! True if a mesh of num_mesh_points points can be stored with indices of type Index
+template< typename Index >
+bool fits_index( size_t num_mesh_points )
+{
+  // Aero node indices start from 1, so the largest one is num_mesh_points
+  return num_mesh_points <= numeric_limits< Index >::max( );
+}
+
+} // namespace comsol
+
 #endif // COMSOLMODEL_HPP
@@ -1,8 +1,13 @@
 #include "comsolparser.hpp"
+#include "blockstream.hpp"
+#include "mappedfile.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <exception>
 #include <fstream>
 #include <iomanip>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
 
@@ -22,14 +27,187 @@ std::string trim( const std::string& str )
 namespace comsol
 {
 
-Parser::Parser( bool verb ) : stdclog( clog, verb ), debugstdout( cerr, true )
+Parser::Parser( bool verb, size_t threads, const string& message_prefix ) :
+  threads_( resolve_thread_count( threads ) ), message_prefix_( message_prefix ),
+  stdclog( clog, verb ), debugstdout( cerr, true )
 {
 }
 
-void Parser::parse( string& file_name )
+template< class Iterator >
+size_t Parser::mesh_points( Iterator first, Iterator last ) const
+{
+  ErrorHandler< Iterator > error_handler( first, last, message_prefix_ );
+  MeshGrammar< Iterator >  mesh_parser( error_handler );
+  MeshSkipper< Iterator >  skipper;
+
+  unsigned long long points = 0;
+
+  try
+  {
+    if ( phrase_parse( first, last, mesh_parser.mesh_points, skipper, points ) )
+    {
+      return points;
+    }
+  }
+  catch ( const expectation_failure< Iterator >& )
+  {
+  }
+  return numeric_limits< size_t >::max( );
+}
+
+size_t Parser::objects( const char* first, const char* last ) const
+{
+  ErrorHandler< const char* > error_handler( first, last, message_prefix_ );
+  MeshGrammar< const char* >  mesh_parser( error_handler );
+  MeshSkipper< const char* >  skipper;
+
+  BasicMesh< size_t >::Types types;
+
+  try
+  {
+    if ( phrase_parse( first, last, mesh_parser.object_types, skipper, types ) )
+    {
+      return types.size( );
+    }
+  }
+  catch ( const expectation_failure< const char* >& )
+  {
+  }
+  return 0;
+}
+
+template< class Iterator >
+bool Parser::parse_range( Iterator first, Iterator last )
+{
+#ifdef COMSOL2AERO_32BIT_INDICES
+  if ( fits_index< uint32_t >( mesh_points( first, last ) ) )
+  {
+    return parse_range( first, last, model.emplace< BasicMesh< uint32_t > >( ) );
+  }
+#endif
+  return parse_range( first, last, model.emplace< BasicMesh< size_t > >( ) );
+}
+
+template< class Index, class Iterator >
+bool Parser::parse_range( Iterator                     first,
+                          Iterator                     last,
+                          BasicMesh< Index >&          mesh,
+                          const MeshHandlers< Index >* handlers )
+{
+  Iterator iter = first;
+  Iterator end  = last;
+
+  ErrorHandler< Iterator > error_handler( iter, end, message_prefix_ );
+
+  typedef MeshGrammar< Iterator, Index > grammar;
+
+  grammar mesh_parser( error_handler, threads_, handlers );
+
+  typedef MeshSkipper< Iterator > skipper_type;
+
+  skipper_type skipper;
+
+  bool r = phrase_parse( iter, end, mesh_parser, skipper, mesh );
+
+  return r && iter == end;
+}
+
+bool Parser::parse_sections( const char* first, const char* last )
+{
+  const auto sections = detail::object_sections( first, last, threads_ );
+
+  if ( sections.empty( ) )
+  {
+    return false;
+  }
+
+#ifdef COMSOL2AERO_32BIT_INDICES
+  if ( fits_index< uint32_t >( mesh_points( first, last ) ) )
+  {
+    return parse_sections( first, last, sections, model.emplace< BasicMesh< uint32_t > >( ) );
+  }
+#endif
+  return parse_sections( first, last, sections, model.emplace< BasicMesh< size_t > >( ) );
+}
+
+template< class Index >
+bool Parser::parse_sections( const char*                   first,
+                             const char*                   last,
+                             const vector< const char* >& sections,
+                             BasicMesh< Index >&           mesh,
+                             const MeshHandlers< Index >*  handlers )
+{
+  using Iterator = const char*;
+
+  mesh.selection_object.resize( sections.size( ) - 1 );
+
+  ErrorHandler< Iterator >       error_handler( first, last, message_prefix_ );
+  MeshGrammar< Iterator, Index > mesh_parser( error_handler, threads_ );
+  MeshSkipper< Iterator >        skipper;
+
+  atomic< bool > success( true );
+
+  // Item 0 is the header, item 1 the mesh object and the rest are selection objects.
+  parallel_for( threads_, sections.size( ) + 1, [ & ]( size_t i ) {
+    Iterator iter = i == 0 ? first : sections[ i - 1 ];
+    Iterator end  = i < sections.size( ) ? sections[ i ] : last;
+
+    bool r = false;
+    try
+    {
+      if ( i == 0 )
+      {
+        r = phrase_parse( iter,
+                          end,
+                          no_skip[ eps ] > mesh_parser.timestamp > mesh_parser.version
+                            > mesh_parser.tags > mesh_parser.types,
+                          skipper,
+                          mesh.created,
+                          mesh.version,
+                          mesh.tags,
+                          mesh.types );
+      }
+      else if ( i == 1 )
+      {
+        MeshObjectGrammar< Iterator, Index > object_parser( threads_, handlers );
+        r = phrase_parse( iter, end, object_parser, skipper, mesh.object );
+      }
+      else
+      {
+        SelectionObjectGrammar< Iterator > selection_parser;
+        r = phrase_parse( iter, end, selection_parser, skipper, mesh.selection_object[ i - 2 ] );
+      }
+    }
+    catch ( const expectation_failure< Iterator >& )
+    {
+    }
+
+    if ( !r || iter != end )
+    {
+      success = false;
+    }
+  } );
+
+  if ( success )
+  {
+    stdclog.print( "Parsed ", sections.size( ), " object sections concurrently." );
+  }
+
+  return success;
+}
+
+void Parser::parse( const string& file_name )
 {
   stdclog.print( "\nOpening for parsing: ", file_name, "\n---" );
 
+  MappedFile mapped( file_name );
+
+  if ( mapped.is_mapped( ) )
+  {
+    parse( mapped.begin( ), mapped.end( ) );
+    return;
+  }
+
   ifstream in( file_name, ios_base::in );
 
   if ( !in )
@@ -42,7 +220,136 @@ void Parser::parse( string& file_name )
   parse( in );
 }
 
-void Parser::print_model( )
+void Parser::parse( istream& stream )
+{
+  BlockStream input( stream );
+
+  auto start = chrono::steady_clock::now( );
+
+  bool r = parse_range( input.begin( ), input.end( ) );
+
+  chrono::duration< double > elapsed = chrono::steady_clock::now( ) - start;
+
+  if ( !r )
+  {
+    throw runtime_error( "Parsing failed" );
+  }
+
+  stdclog.print( "Parsed in ", elapsed.count( ), " s" );
+
+  finish( );
+}
+
+void Parser::parse( const char* first, const char* last )
+{
+  auto start = chrono::steady_clock::now( );
+
+  // Objects are parsed concurrently when the file is well formed. Otherwise the file is parsed
+  // sequentially, which also reports the parsing errors.
+  bool r = parse_sections( first, last ) || parse_range( first, last );
+
+  chrono::duration< double > elapsed = chrono::steady_clock::now( ) - start;
+
+  if ( !r )
+  {
+    throw runtime_error( "Parsing failed" );
+  }
+
+  stdclog.print( "Parsed ",
+                 ( last - first ) / 1.e6,
+                 " MB in ",
+                 elapsed.count( ),
+                 " s (",
+                 ( last - first ) / 1.e6 / elapsed.count( ),
+                 " MB/s, ",
+                 threads_,
+                 " threads)" );
+
+  finish( );
+}
+
+template< class Index >
+void Parser::parse( const char* first, const char* last, const MeshHandlers< Index >& handlers )
+{
+  auto start = chrono::steady_clock::now( );
+
+  auto sections = detail::object_sections( first, last, threads_ );
+
+  // Parts handed over cannot be taken back, so the object sections are only parsed if there is
+  // one for every object of the header
+  if ( sections.size( ) != objects( first, last ) )
+  {
+    sections.clear( );
+  }
+
+  atomic< bool >        handed_over( false );
+  MeshHandlers< Index > tracked = handlers;
+
+  if ( handlers.points )
+  {
+    tracked.points = [ & ]( Coordinates&& points ) {
+      handed_over = true;
+      handlers.points( std::move( points ) );
+    };
+  }
+  if ( handlers.element_set )
+  {
+    tracked.element_set = [ & ]( BasicElementSet< Index >&& set ) {
+      handed_over = true;
+      handlers.element_set( std::move( set ) );
+    };
+  }
+
+  bool r = !sections.empty( )
+           && parse_sections( first, last, sections, model.emplace< BasicMesh< Index > >( ),
+                              &tracked );
+
+  if ( !r && !handed_over )
+  {
+    // Parsed sequentially as without handlers, which also reports the errors
+    r = parse_range( first, last, model.emplace< BasicMesh< Index > >( ), &handlers );
+  }
+  else if ( !r )
+  {
+    // The file is parsed again only to report the errors
+    parse_range( first, last, model.emplace< BasicMesh< Index > >( ) );
+  }
+
+  chrono::duration< double > elapsed = chrono::steady_clock::now( ) - start;
+
+  if ( !r )
+  {
+    throw runtime_error( "Parsing failed" );
+  }
+
+  stdclog.print( "Parsed ", ( last - first ) / 1.e6, " MB in ", elapsed.count( ), " s" );
+
+  finish( );
+}
+
+template void Parser::parse( const char*, const char*, const MeshHandlers< size_t >& );
+#ifdef COMSOL2AERO_32BIT_INDICES
+template void Parser::parse( const char*, const char*, const MeshHandlers< uint32_t >& );
+#endif
+template size_t Parser::mesh_points( const char*, const char* ) const;
+
+void Parser::finish( )
+{
+  visit(
+    [ this ]( auto& mesh ) {
+      // Todo, can we move the trimming inside the parsing?
+      for ( auto& selection_objects : mesh.selection_object )
+      {
+        selection_objects.label = trim( selection_objects.label );
+      }
+
+      print_model( mesh );
+    },
+    model );
+}
+
+template< class Index >
+void Parser::print_model( const BasicMesh< Index >& model )
 {
   using namespace std;
 
@@ -79,6 +386,7 @@ void Parser::print_model( )
     stdclog.print( "  Version: ", model.object.version );
     stdclog.print( "  Space dimensions: ", model.object.space_dimensions );
     stdclog.print( "  Number of mesh points: ", model.object.coordinates.size( ) );
+    stdclog.print( "  Index width: ", 8 * sizeof( Index ), " bits" );
 
     stdclog.print( "  Element types\n    Count: ", model.object.element_sets.size( ) );
 
@@ -90,12 +398,11 @@ void Parser::print_model( )
                      model.object.element_sets[ i ].element_type.first,
                      ' ',
                      model.object.element_sets[ i ].element_type.second );
-      if ( model.object.element_sets[ i ].elements.size( ) > 0 )
+      if ( model.object.element_sets[ i ].size( ) > 0 )
       {
         stdclog.print( "      Nodes per element: ",
-                       model.object.element_sets[ i ].elements[ 0 ].size( ) );
-        stdclog.print( "      Number of elements: ",
-                       model.object.element_sets[ i ].elements.size( ) );
+                       model.object.element_sets[ i ].nodes_per_element );
+        stdclog.print( "      Number of elements: ", model.object.element_sets[ i ].size( ) );
         stdclog.print( "      Number of geometric indicies: ",
                        model.object.element_sets[ i ].geometric_indicies.size( ) );
       }
@@ -41,12 +41,14 @@
 #ifndef COMSOLPARSER_HPP
 #define COMSOLPARSER_HPP
 
+#include "blockparsers.hpp"
 #include "charstreamer.hpp"
 #include "comsolmesh.hpp"
 #include "parsingerrorhandler.hpp"
 
 #include <boost/config/warning_disable.hpp>
 #include <boost/fusion/adapted/std_pair.hpp>
+#include <boost/spirit/include/phoenix_bind.hpp>
 #include <boost/spirit/include/phoenix_core.hpp>
 #include <boost/spirit/include/phoenix_fusion.hpp>
 #include <boost/spirit/include/phoenix_object.hpp>
@@ -55,6 +57,9 @@
 #include <boost/spirit/include/qi.hpp>
 #include <boost/spirit/include/qi_lexeme.hpp>
 
+#include <functional>
+#include <type_traits>
+
 std::string trim( const std::string& str );
 
 namespace comsol
@@ -92,10 +97,13 @@ struct MeshSkipper : public grammar< Iterator >
 };
 
 // Connectivity data grammar
-template< typename Iterator, class skipper = MeshSkipper< Iterator > >
-struct ElementSetGrammar : grammar< Iterator, ElementSet( ), locals< size_t, size_t >, skipper >
+template< typename Iterator, typename Index = size_t, class skipper = MeshSkipper< Iterator > >
+struct ElementSetGrammar : grammar< Iterator, BasicElementSet< Index >( ), skipper >
 {
-  ElementSetGrammar( ) : ElementSetGrammar::base_type( set, "Comsol Element Set" )
+  using ElementSet = BasicElementSet< Index >;
+
+  ElementSetGrammar( size_t threads = 1 ) :
+    ElementSetGrammar::base_type( set, "Comsol Element Set" )
   {
     // FIXME: Maybe relax the element type requirements here.
     element_type %= lexeme[ uint_ > +space ]
@@ -106,47 +114,81 @@ struct ElementSetGrammar : grammar< Iterator, ElementSet( ), locals< size_t, siz
     geom_indicies_count %= omit[ uint_( ref( elemCount ) ) ];
     geom_indicies_count.name( "geometric indicies count equal to element count" );
 
-    set
-      %= element_type > omit[ uint_[ _a = _1 ] ]                 // Number of nodes per element
-         > omit[ uint_[ ref( elemCount ) = _1 ] ]                // Number of elements
-         > repeat( ref( elemCount ) )[ repeat( _a )[ double_ ] ] // Elements
-         > geom_indicies_count // Number of geometric indicies: must be equal to number of elements
-         > repeat( ref( elemCount ) )[ uint_ ]; // Geometric Indicies // FIXME: Handle error on
-                                                // repetition properly
+    elements %= ElementBlockParser< Index >( nodesPerElement, elemCount, threads );
+    elements.name( "Elements" );
+
+    geometric_indicies
+      %= IndexBlockParser< Index, typename ElementSet::GeometricIndicies >( elemCount, threads );
+    geometric_indicies.name( "Geometric indicies" );
+
+    set %= element_type > uint_[ ref( nodesPerElement ) = _1 ] // Number of nodes per element
+           > omit[ uint_[ ref( elemCount ) = _1 ] ]             // Number of elements
+           > elements                                           // Elements
+           > geom_indicies_count // Number of geometric indicies: must be equal to number of elements
+           > geometric_indicies; // Geometric Indicies
 
     set.name( "Comsol element set definition" );
   }
 
-  rule< Iterator, ElementSet( ), locals< size_t, size_t >, skipper > set;
+  rule< Iterator, ElementSet( ), skipper > set;
 
   rule< Iterator, skipper > geom_indicies_count;
 
-  rule< Iterator, ElementSet::ElementType( ), skipper > element_type;
+  rule< Iterator, typename ElementSet::ElementType( ), skipper > element_type;
+
+  rule< Iterator, typename ElementSet::Connectivity( ), skipper > elements;
+
+  rule< Iterator, typename ElementSet::GeometricIndicies( ), skipper > geometric_indicies;
+
+  size_t nodesPerElement = 0;
 
   size_t elemCount = 0;
 };
 
+/*! \brief Receives the parts of a mesh object as soon as each is parsed.
+ *
+ *
+ *  The point coordinates and the connectivity and geometric indicies of
+ *  each element set are moved out of the parsed mesh, which keeps the rest.
+ *  Parts without a function are kept in the mesh.
+ */
+template< typename Index >
+struct MeshHandlers
+{
+  std::function< void( Coordinates&& ) >              points;
+  std::function< void( BasicElementSet< Index >&& ) > element_set;
+
+  //! Called with the end of the input consumed so far, after each part handed over
+  std::function< void( const char* ) > parsed_up_to;
+};
+
 // Mesh (nodes + connectivity)
-template< typename Iterator, class skipper = MeshSkipper< Iterator > >
-struct MeshObjectGrammar : grammar< Iterator, MeshObject( ), locals< size_t, size_t >, skipper >
+template< typename Iterator, typename Index = size_t, class skipper = MeshSkipper< Iterator > >
+struct MeshObjectGrammar :
+  grammar< Iterator, BasicMeshObject< Index >( ), locals< size_t, size_t >, skipper >
 {
-  MeshObjectGrammar( ) : MeshObjectGrammar::base_type( object, "Comsol mesh object" )
+  using MeshObject = BasicMeshObject< Index >;
+
+  MeshObjectGrammar( size_t threads = 1, const MeshHandlers< Index >* handlers = nullptr ) :
+    MeshObjectGrammar::base_type( object, "Comsol mesh object" ), elem_parser( threads ),
+    handlers_( handlers )
   {
 
     baseIndex %= uint_( 0 );
     baseIndex.name( "lowest mesh point index equal to 0" );
 
-    element_sets
-      %= omit[ uint_[ _a = _1 ] ] > repeat(
-           _a )[ elem_parser ]; // Fixme: enforce that number of element sets later in parsing
+    // Fixme: enforce that number of element sets later in parsing
+    element_sets = omit[ uint_[ _a = _1 ] ]
+                   > repeat( _a )[ elem_parser[ phoenix::bind(
+                                     &MeshObjectGrammar::hand_over_set, this, _1, _val ) ]
+                                   >> consumed ];
     element_sets.name( "Element sets" );
 
-    point %= repeat( ref( sdim ) )[ double_ ];
-    point.name( "Point coordinates" );
-
-    coords %= repeat( ref( numPoints ) )[ point ];
+    coords %= CoordinateBlockParser( sdim, numPoints, threads );
     coords.name( "Mesh points definition" );
 
+    consumed = omit[ raw[ eps ][ phoenix::bind( &MeshObjectGrammar::report_position, this, _1 ) ] ];
+
     object
       %= omit[ uint_ > uint_
                > uint_ ] // Not sure about what these three numbers are in the comsol mesh file
@@ -155,21 +197,67 @@ struct MeshObjectGrammar : grammar< Iterator, MeshObject( ), locals< size_t, siz
          > uint_[ ref( sdim ) = _1 ]                // Number of space dimensions
          > uint_[ ref( numPoints ) = _1 ]           // Number of points
          > baseIndex     // First index. FIXME: Support non 0 base indexing
-         > coords        // Point coordinates
+         > coords[ phoenix::bind( &MeshObjectGrammar::hand_over_points, this, _1 ) ] // Points
+         > consumed
          > element_sets; // Element Sets
   }
 
-  rule< Iterator, MeshObject( ), locals< size_t, size_t >, skipper >      object;
-  rule< Iterator, MeshObject::ElementSets( ), locals< size_t >, skipper > element_sets;
-  rule< Iterator, size_t( ), skipper >                                    baseIndex;
-  rule< Iterator, MeshObject::Point( ), skipper >                         point;
-  rule< Iterator, MeshObject::Coords( ), skipper >                        coords;
+  // Hands the parsed points over to the handlers, if any
+  void hand_over_points( Coordinates& points ) const
+  {
+    if ( handlers_ != nullptr && handlers_->points )
+    {
+      handlers_->points( std::move( points ) );
+    }
+  }
 
-  ElementSetGrammar< Iterator > elem_parser;
+  // Reports how far the input is parsed to the handlers, if any. Only input in memory has a
+  // position to report.
+  void report_position( const boost::iterator_range< Iterator >& position ) const
+  {
+    if constexpr ( std::is_same< Iterator, const char* >::value )
+    {
+      if ( handlers_ != nullptr && handlers_->parsed_up_to )
+      {
+        handlers_->parsed_up_to( position.begin( ) );
+      }
+    }
+  }
+
+  // Appends a parsed element set to sets, or hands it over to the handlers, if any, in which case
+  // only its type is appended.
+  void hand_over_set( typename MeshObject::ElementSets::value_type& set,
+                      typename MeshObject::ElementSets&             sets ) const
+  {
+    if ( handlers_ != nullptr && handlers_->element_set )
+    {
+      typename MeshObject::ElementSets::value_type type;
+
+      type.element_type      = set.element_type;
+      type.nodes_per_element = set.nodes_per_element;
+
+      handlers_->element_set( std::move( set ) );
+      sets.push_back( std::move( type ) );
+    }
+    else
+    {
+      sets.push_back( std::move( set ) );
+    }
+  }
+
+  rule< Iterator, MeshObject( ), locals< size_t, size_t >, skipper >               object;
+  rule< Iterator, typename MeshObject::ElementSets( ), locals< size_t >, skipper > element_sets;
+  rule< Iterator, size_t( ), skipper >                                             baseIndex;
+  rule< Iterator, Coordinates( ), skipper >                                        coords;
+  rule< Iterator, skipper >                                                        consumed;
+
+  ElementSetGrammar< Iterator, Index > elem_parser;
 
   size_t sdim = 0;
 
   size_t numPoints = 0;
+
+  const MeshHandlers< Index >* handlers_;
 };
 
 // Selection (nodes + connectivity)
@@ -184,7 +272,7 @@ struct SelectionObjectGrammar :
     label.name( "Object label followed by # Label" );
     //  baseIndex.name( "lowest selection point index equal to 0" );
 
-    entities %= repeat( ref( numEntities ) )[ uint_ ];
+    entities %= IndexBlockParser( numEntities );
     entities.name( "Selection entities" );
 
     object %= omit[ uint_ > uint_
@@ -202,11 +290,16 @@ struct SelectionObjectGrammar :
   size_t numEntities = 0;
 };
 
-template< typename Iterator, class skipper = MeshSkipper< Iterator > >
-struct MeshGrammar : grammar< Iterator, Mesh( ), skipper >
+template< typename Iterator, typename Index = size_t, class skipper = MeshSkipper< Iterator > >
+struct MeshGrammar : grammar< Iterator, BasicMesh< Index >( ), skipper >
 {
-  MeshGrammar( ErrorHandler< Iterator >& error_handler ) :
-    MeshGrammar::base_type( mesh, "Comsol mesh" ), error_handler_( error_handler )
+  using Mesh = BasicMesh< Index >;
+
+  MeshGrammar( ErrorHandler< Iterator >&     error_handler,
+               size_t                        threads  = 1,
+               const MeshHandlers< Index >* handlers = nullptr ) :
+    MeshGrammar::base_type( mesh, "Comsol mesh" ), obj_parser( threads, handlers ),
+    error_handler_( error_handler )
   {
     typedef function< ErrorHandler< Iterator > > ErrorHandler_function;
 
@@ -235,18 +328,29 @@ struct MeshGrammar : grammar< Iterator, Mesh( ), skipper >
     mesh %= no_skip[ eps ] > timestamp > version > tags > types > comsol_mesh_object
             > repeat[ comsol_selection_object ];
 
+    // Reads the header up to the number of mesh points, which selects the index width
+    mesh_points %= no_skip[ eps ] > omit[ timestamp > version > tags > types ]
+                   > omit[ uint_ > uint_ > uint_ ]
+                   > omit[ lexeme[ uint_ > +space > lit( "Mesh" ) ] ] > omit[ uint_ > uint_ ]
+                   > ulong_long;
+
+    // Reads the header up to the object types, one per object
+    object_types %= no_skip[ eps ] > omit[ timestamp > version > tags ] > types;
+
     on_error< fail >( mesh, ErrorHandler_function( error_handler_ )( "Error:", _4, _3 ) );
   }
 
-  rule< Iterator, Mesh( ), skipper >                          mesh;
-  rule< Iterator, string( ), skipper >                        timestamp;
-  rule< Iterator, Mesh::Version( ), skipper >                 version;
-  rule< Iterator, Mesh::Tags( ), locals< size_t >, skipper >  tags;
-  rule< Iterator, Mesh::Types( ), locals< size_t >, skipper > types;
-  rule< Iterator, MeshObject( ), skipper >                    comsol_mesh_object;
-  rule< Iterator, SelectionObject( ), skipper >               comsol_selection_object;
-
-  MeshObjectGrammar< Iterator >      obj_parser;
+  rule< Iterator, Mesh( ), skipper >                                   mesh;
+  rule< Iterator, string( ), skipper >                                 timestamp;
+  rule< Iterator, typename Mesh::Version( ), skipper >                 version;
+  rule< Iterator, typename Mesh::Tags( ), locals< size_t >, skipper >  tags;
+  rule< Iterator, typename Mesh::Types( ), locals< size_t >, skipper > types;
+  rule< Iterator, BasicMeshObject< Index >( ), skipper >               comsol_mesh_object;
+  rule< Iterator, SelectionObject( ), skipper >                        comsol_selection_object;
+  rule< Iterator, unsigned long long( ), skipper >                     mesh_points;
+  rule< Iterator, typename Mesh::Types( ), skipper >                   object_types;
+
+  MeshObjectGrammar< Iterator, Index > obj_parser;
   SelectionObjectGrammar< Iterator > sel_obj_parser;
 
   ErrorHandler< Iterator >& error_handler_;
@@ -255,62 +359,79 @@ struct MeshGrammar : grammar< Iterator, Mesh( ), skipper >
 class Parser
 {
 public:
-  Parser( bool verb );
-
-  template< class S >
-  void parse( S& stream )
+  //! Parse errors are reported starting with message_prefix, e.g. the job of a batch
+  Parser( bool verb, size_t threads = 1, const string& message_prefix = "" );
+
+  /*! Parses a stream. The stream is read in large blocks by a background thread while parsing
+   *  proceeds on the data already read. This is the path for inputs that cannot be memory mapped
+   *  (i.e. standard input and pipes).
+   */
+  void parse( istream& stream );
+
+  //! Parses a file. Regular files are memory mapped and parsed in place.
+  void parse( const string& file_name );
+
+  //! Parses an in memory character range.
+  void parse( const char* first, const char* last );
+
+  /*! Parses an in memory character range into a mesh of index type Index, handing its parts over
+   *  to handlers as soon as each is parsed. Parsing errors are reported after the parts parsed
+   *  before them were handed over.
+   */
+  template< class Index >
+  void parse( const char* first, const char* last, const MeshHandlers< Index >& handlers );
+
+  //! Number of mesh points declared in the header, or the largest size_t if the header could not
+  //! be read.
+  template< class Iterator >
+  size_t mesh_points( Iterator first, Iterator last ) const;
+
+  //! The parsed mesh, stored with the narrowest index type that fits its number of points.
+  const AnyMesh& getModel( ) const
   {
+    return model;
+  }
 
-    model = Mesh( );
-
-    string storage;
-
-    stream.unsetf( ios::skipws ); // No white space skipping
-
-    copy(
-      istream_iterator< char >( stream ), istream_iterator< char >( ), back_inserter( storage ) );
-
-    string::const_iterator iter = storage.begin( );
-    string::const_iterator end  = storage.end( );
-
-    ErrorHandler< string::const_iterator > error_handler( iter, end );
-
-    typedef MeshGrammar< string::const_iterator > grammar;
+  //! The parsed mesh, which may be consumed by the conversion.
+  AnyMesh& getModel( )
+  {
+    return model;
+  }
 
-    grammar mesh_parser( error_handler );
+private:
+  // Parses the whole input with MeshGrammar. Returns false on failure, after reporting it.
+  template< class Iterator >
+  bool parse_range( Iterator first, Iterator last );
 
-    typedef MeshSkipper< string::const_iterator > skipper_type;
+  template< class Index, class Iterator >
+  bool parse_range( Iterator                     first,
+                    Iterator                     last,
+                    BasicMesh< Index >&          mesh,
+                    const MeshHandlers< Index >* handlers = nullptr );
 
-    skipper_type skipper;
+  // Parses the header and every object section concurrently. Returns false if the file is not
+  // split in well formed object sections. Errors are not reported.
+  bool parse_sections( const char* first, const char* last );
 
-    bool r = phrase_parse( iter, end, mesh_parser, skipper, model );
+  template< class Index >
+  bool parse_sections( const char*                        first,
+                       const char*                        last,
+                       const std::vector< const char* >& sections,
+                       BasicMesh< Index >&                mesh,
+                       const MeshHandlers< Index >*       handlers = nullptr );
 
-    if ( r && iter == end )
-    {
-      // Todo, can we move the trimming inside the parsing?
-      for ( auto& selection_objects : model.selection_object )
-      {
-        selection_objects.label = trim( selection_objects.label );
-      }
-      print_model( );
-    }
-    else
-    {
-      throw runtime_error( "Parsing failed" );
-    }
-  }
+  // Number of objects declared in the header, 0 if the header could not be read
+  size_t objects( const char* first, const char* last ) const;
 
-  void parse( string& file_name );
+  void finish( );
 
-  const Mesh& getModel( ) const
-  {
-    return model;
-  }
+  template< class Index >
+  void print_model( const BasicMesh< Index >& mesh );
 
-private:
-  void print_model( );
+  AnyMesh model;
 
-  Mesh model;
+  size_t threads_;
+  string message_prefix_;
 
   CharStreamer< ostream > stdclog;
 #ifdef NDEBUG
@@ -0,0 +1,102 @@
+#include "conversion.hpp"
+#include "aerofgenerator.hpp"
+#include "aerosgenerator.hpp"
+#include "comsolparser.hpp"
+#include "converter.hpp"
+#include "parallel.hpp"
+#include "pipeline.hpp"
+
+#include <iostream>
+#include <type_traits>
+#include <variant>
+
+using namespace std;
+
+namespace
+{
+
+// Writes to the standard output if no file name is given
+template< class Generator >
+void generate( const Generator& generator, const string& file_name )
+{
+  if ( file_name == "" )
+  {
+    generator.generate( std::cout );
+  }
+  else
+  {
+    generator.generate( file_name );
+  }
+}
+
+} // namespace
+
+void convert( const UserOptions& options, const function< void( const char* ) >& phase_completed )
+{
+  const auto completed = [ & ]( const char* phase ) {
+    if ( phase_completed )
+    {
+      phase_completed( phase );
+    }
+  };
+
+  if ( options.pipeline && run_pipeline( options ) )
+  {
+    completed( "converting in a pipeline" );
+    return;
+  }
+
+  comsol::Parser Parser( options.verbose, options.threads, options.message_prefix );
+
+  if ( options.input_file_name == "" )
+  {
+    Parser.parse( std::cin );
+  }
+  else
+  {
+    Parser.parse( options.input_file_name );
+  }
+  completed( "parsing" );
+
+  // The aero mesh uses the index type the comsol mesh was parsed with
+  visit(
+    [ & ]( auto& comsolMesh ) {
+      using Index = typename std::decay_t< decltype( comsolMesh ) >::IndexType;
+
+      aero::BasicMesh< Index > aeroMesh;
+      BasicConverter< Index >  conv( options.verbose,
+                                    options.use_selections,
+                                    options.element_mapping,
+                                    options.surface_name_prefixes,
+                                    options.accepted_selections,
+                                    options.threads,
+                                    options.message_prefix );
+
+      // The comsol mesh is not needed after the conversion
+      conv.convert( std::move( comsolMesh ), aeroMesh );
+      completed( "converting" );
+
+      // Every output is generated from the same aero mesh, concurrently if there are several
+      parallel_for(
+        resolve_thread_count( options.threads ), options.outputs.size( ), [ & ]( size_t i ) {
+          const OutputTarget& target = options.outputs[ i ];
+
+          if ( target.aerof == false )
+          {
+            aeros::BasicGenerator< Index > generator(
+              options.verbose, options.matusage, aeroMesh, options.real_format, options.threads );
+
+            generate( generator, target.file_name );
+          }
+          else
+          {
+            aerof::BasicGenerator< Index > generator(
+              options.verbose, aeroMesh, options.real_format, options.threads );
+
+            generate( generator, target.file_name );
+          }
+        } );
+      completed( "generating" );
+    },
+    Parser.getModel( ) );
+}
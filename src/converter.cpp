@@ -1,9 +1,15 @@
 #include "converter.hpp"
+#include "allocationcounter.hpp"
 #include "comsolmesh.hpp"
+#include "parallel.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <sstream>
 
 using namespace std;
@@ -11,25 +17,28 @@ using namespace std;
 // mappings
 //                      Comsol id (minus one)----|--->
 //                                    |
-using TriMapper  = ComsolToAeroElementMapper< 2, 0, 1 >;
-using QuadMapper = ComsolToAeroElementMapper< 2, 0, 1, 3 >;
-using TetMapper  = ComsolToAeroElementMapper< 2, 0, 1, 3 >;
+template< class Index >
+using TriMapper = ComsolToAeroElementMapper< Index, 2, 0, 1 >;
+template< class Index >
+using QuadMapper = ComsolToAeroElementMapper< Index, 2, 0, 1, 3 >;
+template< class Index >
+using TetMapper = ComsolToAeroElementMapper< Index, 2, 0, 1, 3 >;
 // typedef ComsolToAeroElementMapper< 2, 1, 0, 3 > tet_50_96_103_mapper; // special mapping for
 // these types (probably not needed though)
-using PyrMapper   = ComsolToAeroElementMapper< 4, 4, 4, 4, 2, 0, 1, 3 >;
-using PrismMapper = ComsolToAeroElementMapper< 2, 0, 1, 5, 3, 4 >;
-using HexMapper   = ComsolToAeroElementMapper< 6, 2, 3, 7, 4, 0, 1, 5 >;
-
-template< class T >
-shared_ptr< ComsolToAeroElementMapperBase > mapper( const string&                id,
-                                                    const map< string, size_t >& mapping_options )
+template< class Index >
+using PyrMapper = ComsolToAeroElementMapper< Index, 4, 4, 4, 4, 2, 0, 1, 3 >;
+template< class Index >
+using PrismMapper = ComsolToAeroElementMapper< Index, 2, 0, 1, 5, 3, 4 >;
+template< class Index >
+using HexMapper = ComsolToAeroElementMapper< Index, 6, 2, 3, 7, 4, 0, 1, 5 >;
+
+template< class T, class Index >
+ElementMapper< Index > mapper( const string& id, const map< string, size_t >& mapping_options )
 {
-  using Ptr = shared_ptr< ComsolToAeroElementMapperBase >;
-
   auto iter = mapping_options.find( id );
   if ( iter != mapping_options.end( ) )
   {
-    return Ptr( new T( iter->second ) );
+    return T::mapper( iter->second );
   }
   else
   {
@@ -39,46 +48,150 @@ shared_ptr< ComsolToAeroElementMapperBase > mapper( const string&
   }
 }
 
-bool is_surface_selection( const comsol::SelectionObject so )
+bool is_surface_selection( const comsol::SelectionObject& so )
 {
   return so.dim_size == 2;
 }
 
-Converter::Converter( bool                         verb,
-                      bool                         associate_selections_with_attributes,
-                      const map< string, size_t >& mapping_options,
-                      const std::vector< string >& pr,
-                      const std::vector< string >& accepted_selections ) :
-  selections_to_attributes( associate_selections_with_attributes ),
-  prefixes( pr ), accepted_selections_( accepted_selections ), std_clog( clog, verb ),
-  debug_stdout( cerr, true )
+// The mapping kernels read the first nodes of every element, which must exist.
+template< class Index >
+void check_node_count( const comsol::BasicElementSet< Index >& element_set,
+                       const ElementMapper< Index >&           mapper )
 {
+  if ( element_set.size( ) != 0 && element_set.nodes_per_element < mapper.get_from_node_count( ) )
+  {
+    stringstream ss;
+    ss << "Elements of type " << element_set.element_type.second << " have "
+       << element_set.nodes_per_element << " nodes, at least " << mapper.get_from_node_count( )
+       << " are required.";
+    throw runtime_error( ss.str( ) );
+  }
+}
+
+// Storage of a mesh that is consumed by the conversion, which may be taken over
+template< class T >
+T* disposable( T& storage )
+{
+  return &storage;
+}
+
+// Storage of a mesh that is only read
+template< class T >
+T* disposable( const T& )
+{
+  return nullptr;
+}
+
+// Frees the storage of an element set of a mesh that is consumed by the conversion
+template< class Index >
+void release( comsol::BasicElementSet< Index >& element_set )
+{
+  typename comsol::BasicElementSet< Index >::Connectivity( ).swap( element_set.connectivity );
+  typename comsol::BasicElementSet< Index >::GeometricIndicies( ).swap(
+    element_set.geometric_indicies );
+}
+
+// The element sets of a mesh that is only read are kept
+template< class Index >
+void release( const comsol::BasicElementSet< Index >& )
+{
+}
+
+/*! \brief Positions of the elements of a set, bucketed by geometric entity.
+ *
+ *
+ *  Built with a counting sort over the geometric indices, so the elements of
+ *  an entity are found without scanning the whole set.
+ */
+template< class Index >
+class GeometricEntityIndex
+{
+public:
+  GeometricEntityIndex( const SpillVector< Index >& geometry_set )
+  {
+    const size_t entities
+      = geometry_set.empty( )
+          ? 0
+          : *std::max_element( geometry_set.begin( ), geometry_set.end( ) ) + size_t( 1 );
+
+    offsets_.assign( entities + 1, 0 );
+
+    for ( const auto entity : geometry_set )
+    {
+      offsets_[ entity + 1 ]++;
+    }
+    std::partial_sum( offsets_.begin( ), offsets_.end( ), offsets_.begin( ) );
+
+    std::vector< size_t > next( offsets_.begin( ), offsets_.end( ) - 1 );
+    elements_.resize( geometry_set.size( ) );
+
+    for ( size_t j = 0; j != geometry_set.size( ); j++ )
+    {
+      elements_[ next[ geometry_set[ j ] ]++ ] = j;
+    }
+  }
 
-  using Ptr = shared_ptr< ComsolToAeroElementMapperBase >;
+  //! Number of geometric entities: the largest geometric index plus one
+  size_t size( ) const
+  {
+    return offsets_.size( ) - 1;
+  }
+
+  //! Positions, in increasing order, of the elements that belong to entity
+  Span< const size_t > elements( size_t entity ) const
+  {
+    if ( entity + 1 >= offsets_.size( ) )
+    {
+      return Span< const size_t >( );
+    }
+    return Span< const size_t >( elements_.data( ) + offsets_[ entity ],
+                                 offsets_[ entity + 1 ] - offsets_[ entity ] );
+  }
+
+private:
+  std::vector< size_t > offsets_; // Entity e owns elements_[offsets_[e], offsets_[e + 1])
+  SpillVector< size_t > elements_;
+};
+
+template< class Index >
+BasicConverter< Index >::BasicConverter( bool verb,
+                                         bool associate_selections_with_attributes,
+                                         const map< string, size_t >& mapping_options,
+                                         const std::vector< string >& pr,
+                                         const std::vector< string >& accepted_selections,
+                                         size_t                       threads,
+                                         const string&                message_prefix ) :
+  selections_to_attributes( associate_selections_with_attributes ),
+  prefixes( pr ), accepted_selections_( accepted_selections ),
+  threads_( resolve_thread_count( threads ) ), message_prefix_( message_prefix ),
+  std_clog( clog, verb ), std_cerr( cerr, true ), debug_stdout( cerr, true )
+{
 
   // FIXME: These map tri, quad elements to surfacetopo. Will maybe need functionality to map to
   // domain elements.
   // FIXME: Test the output of selection for tri and quad
-  boundary_mappers[ "tri" ]  = mapper< TriMapper >( "tri", mapping_options );
-  boundary_mappers[ "quad" ] = Ptr( new QuadMapper( 1 ) );
+  boundary_mappers[ "tri" ]  = mapper< TriMapper< Index >, Index >( "tri", mapping_options );
+  boundary_mappers[ "quad" ] = QuadMapper< Index >::mapper( 1 );
 
-  domain_mappers[ "tet" ] = mapper< TetMapper >( "tet", mapping_options );
+  domain_mappers[ "tet" ] = mapper< TetMapper< Index >, Index >( "tet", mapping_options );
   // domain_mappers[ "tet_50_96_103" ]   = mapper< tet_50_96_103_mapper >   ( "tet_50_96_103",
   // mapping_options );
-  domain_mappers[ "pyr" ]   = mapper< PyrMapper >( "pyr", mapping_options );
-  domain_mappers[ "prism" ] = mapper< PrismMapper >( "prism", mapping_options );
-  domain_mappers[ "hex" ]   = mapper< HexMapper >( "hex", mapping_options );
+  domain_mappers[ "pyr" ]   = mapper< PyrMapper< Index >, Index >( "pyr", mapping_options );
+  domain_mappers[ "prism" ] = mapper< PrismMapper< Index >, Index >( "prism", mapping_options );
+  domain_mappers[ "hex" ]   = mapper< HexMapper< Index >, Index >( "hex", mapping_options );
 }
 
-void Converter::map_3d_comsol_selections_to_aero_attributes(
-  const comsol::Mesh::SelectionObjects&        selection_objects,
-  aero::Mesh&                                  aero_mesh,
-  std::size_t&                                 attribute_overwrites,
-  const comsol::ElementSet::GeometricIndicies& geometry_set,
-  std::size_t&                                 not_assigned ) const
+template< class Index >
+void BasicConverter< Index >::map_3d_comsol_selections_to_aero_attributes(
+  const typename ComsolMesh::SelectionObjects&                        selection_objects,
+  AeroMesh&                                                           aero_mesh,
+  std::size_t&                                                        attribute_overwrites,
+  const typename comsol::BasicElementSet< Index >::GeometricIndicies& geometry_set,
+  std::size_t&                                                        not_assigned ) const
 {
-  auto                selection_id = geometry_set;
-  std::vector< bool > already_set( selection_id.size( ), false );
+  // The last selection that contains each geometric entity, and how many do
+  std::vector< std::size_t > entity_selection;
+  std::vector< std::size_t > entity_hits;
 
   for ( std::size_t i = 0; i != selection_objects.size( ); i++ )
   {
@@ -112,166 +225,79 @@ void Converter::map_3d_comsol_selections_to_aero_attributes(
 
     for ( const auto entity : selection_object.entities )
     {
-      for ( std::size_t j = 0; j != selection_id.size( ); j++ )
+      if ( entity >= entity_hits.size( ) )
       {
-        if ( geometry_set[ j ] == entity )
-        {
-          if ( already_set[ j ] )
-          {
-            attribute_overwrites++;
-          }
-          selection_id[ j ] = id + 1; // We are starting from 1 in mat definitions in the generator
-          already_set[ j ]  = true;
-        }
+        entity_selection.resize( entity + 1, 0 );
+        entity_hits.resize( entity + 1, 0 );
       }
+      // We are starting from 1 in mat definitions in the generator
+      entity_selection[ entity ] = id + 1;
+      entity_hits[ entity ]++;
     }
   }
-  not_assigned += std::count( already_set.begin( ), already_set.end( ), false );
-
-  copy( selection_id.begin( ), selection_id.end( ), back_inserter( aero_mesh.attributes ) );
-}
-
-void Converter::convert( const comsol::Mesh& comsol_mesh, aero::Mesh& aero_mesh ) const
-{
-  std_clog.print( "\nConverting mesh of comsol mesh to aero mesh...\n" );
-
-  std_clog.print( "Converting nodes..." );
-
-  const auto& coords = comsol_mesh.object.coordinates;
-
-  std_clog.print( "  Number of nodes: ", coords.size( ) );
 
-  copy( coords.begin( ), coords.end( ), back_inserter( aero_mesh.nodes ) );
+  // Later selections overwrite earlier ones, elements of no selection keep their geometric index
+  auto& attributes = aero_mesh.attributes;
 
-  auto& surface_topologies = aero_mesh.surface_topologies;
-
-  std::size_t attribute_overwrites = 0;
-  std::size_t not_assigned         = 0;
+  const size_t first = attributes.size( );
+  attributes.resize( first + geometry_set.size( ) );
 
-  const auto& selection_objects = comsol_mesh.selection_object;
+  const size_t          block = size_t( 1 ) << 16;
+  std::vector< size_t > overwrites( ( geometry_set.size( ) + block - 1 ) / block, 0 );
+  std::vector< size_t > unassigned( overwrites.size( ), 0 );
 
-  std_clog.print( "Converting topology" );
-  for ( size_t i = 0; i != comsol_mesh.object.element_sets.size( ); i++ )
-  {
-
-    const auto& elementSet    = comsol_mesh.object.element_sets[ i ];
-    const auto& element_type  = elementSet.element_type;
-    const auto& elementNameId = element_type.second;
-    const auto& elements      = elementSet.elements;
-    const auto& geometry_set  = elementSet.geometric_indicies;
+  parallel_for_blocks( threads_, geometry_set.size( ), block, [ & ]( size_t begin, size_t end ) {
+    size_t& block_overwrites = overwrites[ begin / block ];
+    size_t& block_unassigned = unassigned[ begin / block ];
 
-    if ( elements.size( ) != geometry_set.size( ) )
+    for ( size_t j = begin; j != end; j++ )
     {
-      throw runtime_error(
-        "Geometric index size and element array size are not the same." ); // This is not supposed
-                                                                           // to happen.
-    }
-
-    auto iter = domain_mappers.find( elementNameId );
+      const size_t entity = geometry_set[ j ];
 
-    if ( iter != domain_mappers.end( ) )
-    {
-      MapperPtr mapper = iter->second;
-
-      //            // This is kind of a hack. TODO: integrate this better
-      //            if ( ( mapper->get_to_id() == 50 ) || ( mapper->get_to_id() == 96 ) || (
-      //            mapper->get_to_id() == 103 ) )
-      //            {
-      //                mapper = domain_mappers.find( "tet_50_96_103" )->second;
-      //            }
-
-      std_clog.print( "Comsol type id: ",
-                     elementNameId,
-                     "(",
-                     elements[ 0 ].size( ),
-                     " nodes) to aero type id: ",
-                     mapper->get_to_id( ) );
-      std_clog.print( "  Number of elements: ", elements.size( ) );
-
-      for ( size_t j = 0; j != elements.size( ); j++ )
-      {
-        auto connectivity = mapper->map( elements[ j ] );
-        // Pushing elements
-        aero_mesh.elements.push_back( aero::Mesh::Element( mapper->get_to_id( ), connectivity ) );
-      }
-
-      if ( !selections_to_attributes )
+      if ( entity < entity_hits.size( ) && entity_hits[ entity ] != 0 )
       {
-        // Copying attributes of each element type ( the comsol domain ids )
-        copy( geometry_set.begin( ), geometry_set.end( ), back_inserter( aero_mesh.attributes ) );
+        attributes[ first + j ] = static_cast< Index >( entity_selection[ entity ] );
+        block_overwrites += entity_hits[ entity ] - 1;
       }
       else
       {
-        map_3d_comsol_selections_to_aero_attributes(
-          selection_objects, aero_mesh, attribute_overwrites, geometry_set, not_assigned );
+        attributes[ first + j ] = geometry_set[ j ];
+        block_unassigned++;
       }
-
-      // map_comsol_surface_selections_to_aero_surfacetopo( selection_objects, aero_mesh, elementSet
-      // );
     }
-    else
-    {
-      iter = boundary_mappers.find( elementNameId );
+  } );
 
-      if ( iter != boundary_mappers.end( ) )
-      {
-
-        MapperPtr mapper = iter->second;
-
-        std_clog.print( "Comsol type id: ",
-                       elementNameId,
-                       " to Aero surfacetopo type id: ",
-                       mapper->get_to_id( ) );
-        std_clog.print( "  Number of faces: ", geometry_set.size( ) );
-
-        // Collect the  connectivity data on surface topologies
-        for ( size_t j = 0; j != geometry_set.size( ); j++ )
-        {
-          auto connectivity = mapper->map( elements[ j ] );
-
-          std::string prefix;
-          if ( prefixes.size( ) != 0 )
-          {
-            if ( geometry_set[ j ] >= prefixes.size( ) )
-            {
-              throw std::invalid_argument(
-                "Comsol geometry contains more surfaces than the number of surface names "
-                "provided." );
-            }
-            prefix = prefixes[ geometry_set[ j ] ];
-          }
-
-          aero::Mesh::TopologyId id( prefix, geometry_set[ j ] + 1 );
-
-          auto& geom = surface_topologies[ id ];
-          geom.push_back( aero::Mesh::Element( mapper->get_to_id( ), connectivity ) );
-        }
-
-        // map_comsol_surface_selections_to_aero_surfacetopo( selection_objects, aero_mesh,
-        // elementSet );
-      }
-      else
-      {
-        std_clog.print(
-          "Warning: Element with Comsol id name: ", elementNameId, " is not currently supported." );
-      }
-    }
+  attribute_overwrites += std::accumulate( overwrites.begin( ), overwrites.end( ), size_t( 0 ) );
+  not_assigned += std::accumulate( unassigned.begin( ), unassigned.end( ), size_t( 0 ) );
+}
 
-    if ( accepted_selections_.size( ) == 0 )
-    {
-      for ( const auto& selection : selection_objects )
-      {
-        aero_mesh.attribute_labels.push_back( selection.label );
-      }
-    }
-    else
+template< class Index >
+void BasicConverter< Index >::push_attribute_labels(
+  const typename ComsolMesh::SelectionObjects& selection_objects,
+  AeroMesh&                                    aero_mesh ) const
+{
+  if ( accepted_selections_.size( ) == 0 )
+  {
+    for ( const auto& selection : selection_objects )
     {
-      for ( const auto& label : accepted_selections_ )
-        aero_mesh.attribute_labels.push_back( label );
+      aero_mesh.attribute_labels.push_back( selection.label );
     }
   }
+  else
+  {
+    for ( const auto& label : accepted_selections_ )
+      aero_mesh.attribute_labels.push_back( label );
+  }
+}
+
+template< class Index >
+void BasicConverter< Index >::map_surface_selections(
+  const typename ComsolMesh::SelectionObjects& selection_objects,
+  const std::vector< std::size_t >&            topology_of_entity,
+  AeroMesh&                                    aero_mesh ) const
+{
+  const auto& surface_topologies = aero_mesh.surface_topologies;
 
-  // Convert surface selections
   if ( selection_objects.size( ) != 0 )
   {
     std_clog.print( "Surface selections conversion." );
@@ -286,41 +312,45 @@ void Converter::convert( const comsol::Mesh& comsol_mesh, aero::Mesh& aero_mesh
       std_clog.print( "  Surface Selection: ", selection_object.label );
       std_clog.print( "    Entities: ", selection_object.entities.size( ) );
 
-      aero_mesh.selection_surface_topologies.push_back( aero::Mesh::SelectionSurfaceTopology( ) );
+      aero_mesh.selection_surface_topologies.push_back(
+        typename AeroMesh::SelectionSurfaceTopology( ) );
 
       auto& selection_surface_topology = *( aero_mesh.selection_surface_topologies.rbegin( ) );
 
       selection_surface_topology.first = selection_object.label;
       auto& selection_surface_elements = selection_surface_topology.second;
 
+      // The faces are referenced, not copied
       for ( const auto entityID : selection_object.entities )
       {
-        for ( const auto& entity : surface_topologies )
+        if ( entityID < topology_of_entity.size( )
+             && topology_of_entity[ entityID ] < surface_topologies.size( ) )
         {
-          if ( entity.first.second - 1 == entityID )
-          {
-            const auto& elems = entity.second;
-            for ( const auto& e : elems )
-            {
-              selection_surface_elements.push_back( e );
-            }
-          }
+          selection_surface_elements.push_back(
+            surface_topologies[ topology_of_entity[ entityID ] ].second );
         }
       }
     }
   }
+}
 
+template< class Index >
+void BasicConverter< Index >::check_attributes(
+  const typename ComsolMesh::SelectionObjects& selection_objects,
+  std::size_t                                  attribute_overwrites,
+  std::size_t                                  not_assigned ) const
+{
   if ( attribute_overwrites )
   {
-    std::cerr << "Warning: " << attribute_overwrites
-              << " overwrites of element attributes. Later selection "
-                 "sets were prioritized.\n";
+    std_cerr.print( message_prefix_,
+                    "Warning: ",
+                    attribute_overwrites,
+                    " overwrites of element attributes. Later selection sets were prioritized." );
   }
   if ( not_assigned )
   {
-    std::cerr << "Warning: " << not_assigned
-              << ", elements were not"
-                 " assigned a selection.\n";
+    std_cerr.print(
+      message_prefix_, "Warning: ", not_assigned, ", elements were not assigned a selection." );
     if ( accepted_selections_.size( ) != 0 )
     {
 
@@ -348,3 +378,281 @@ void Converter::convert( const comsol::Mesh& comsol_mesh, aero::Mesh& aero_mesh
     }
   }
 }
+
+
+template< class Index >
+void BasicConverter< Index >::convert( const ComsolMesh& comsol_mesh, AeroMesh& aero_mesh ) const
+{
+  convert_mesh( comsol_mesh, aero_mesh );
+}
+
+template< class Index >
+void BasicConverter< Index >::convert( ComsolMesh&& comsol_mesh, AeroMesh& aero_mesh ) const
+{
+  convert_mesh( comsol_mesh, aero_mesh );
+}
+
+template< class Index >
+template< class Mesh >
+void BasicConverter< Index >::convert_mesh( Mesh& comsol_mesh, AeroMesh& aero_mesh ) const
+{
+  std_clog.print( "\nConverting mesh of comsol mesh to aero mesh...\n" );
+
+  auto start = chrono::steady_clock::now( );
+
+#ifdef COMSOL2AERO_COUNT_ALLOCATIONS
+  const std::size_t allocations = allocation_count( );
+#endif
+
+  std_clog.print( "Converting nodes..." );
+
+  const auto& coords = comsol_mesh.object.coordinates;
+
+  std_clog.print( "  Number of nodes: ", coords.size( ) );
+
+  if ( auto* consumed = disposable( comsol_mesh.object.coordinates ) )
+  {
+    aero_mesh.nodes = std::move( *consumed );
+  }
+  else
+  {
+    aero_mesh.nodes = coords; // Shares the coordinate buffer
+  }
+
+  // Element sets are converted as parts, in order, the domain elements into aero_mesh
+  Parts parts;
+
+  for ( auto& elementSet : comsol_mesh.object.element_sets )
+  {
+    convert_set( elementSet, parts, aero_mesh.elements, aero_mesh );
+
+    release( elementSet );
+  }
+
+  finish_parts( comsol_mesh.selection_object, parts, aero_mesh );
+
+  chrono::duration< double > elapsed = chrono::steady_clock::now( ) - start;
+  std_clog.print( "Converted in ", elapsed.count( ), " s (", threads_, " threads)" );
+
+#ifdef COMSOL2AERO_COUNT_ALLOCATIONS
+  std_clog.print( "Heap allocations during conversion: ", allocation_count( ) - allocations );
+#endif
+}
+
+template< class Index >
+typename BasicConverter< Index >::AeroMesh::Elements
+BasicConverter< Index >::convert_part( comsol::BasicElementSet< Index >&& element_set,
+                                       Parts&                             parts,
+                                       AeroMesh&                          aero_mesh ) const
+{
+  typename AeroMesh::Elements elements;
+
+  convert_set( element_set, parts, elements, aero_mesh );
+
+  return elements;
+}
+
+template< class Index >
+template< class Set >
+void BasicConverter< Index >::convert_set( Set&                         element_set,
+                                           Parts&                       parts,
+                                           typename AeroMesh::Elements& elements,
+                                           AeroMesh&                    aero_mesh ) const
+{
+  const auto& elementNameId = element_set.element_type.second;
+  const auto& geometry_set  = element_set.geometric_indicies;
+
+  if ( element_set.size( ) != geometry_set.size( ) )
+  {
+    throw runtime_error( "Geometric index size and element array size are not the same." );
+  }
+
+  parts.element_sets++;
+
+  auto iter = domain_mappers.find( elementNameId );
+
+  if ( iter != domain_mappers.end( ) )
+  {
+    const auto& mapper = iter->second;
+
+    std_clog.print( "Comsol type id: ",
+                    elementNameId,
+                    "(",
+                    element_set.nodes_per_element,
+                    " nodes) to aero type id: ",
+                    mapper.get_to_id( ) );
+    std_clog.print( "  Number of elements: ", element_set.size( ) );
+
+    check_node_count( element_set, mapper );
+
+    const size_t count        = element_set.size( );
+    auto*        connectivity = disposable( element_set.connectivity );
+
+    if ( connectivity != nullptr && element_set.nodes_per_element == mapper.get_to_node_count( ) )
+    {
+      std_clog.print( "  Converted in place" );
+
+      // Taking over the comsol connectivity, or appending it, mapped in place in blocks
+      const auto to = elements.push_back(
+        mapper.get_to_id( ), mapper.get_to_node_count( ), std::move( *connectivity ) );
+
+      parallel_for_blocks( threads_, count, size_t( 1 ) << 16, [ & ]( size_t begin, size_t end ) {
+        mapper.map_in_place( to, begin, end );
+      } );
+    }
+    else
+    {
+      // Pushing elements, the whole set at once, mapped in blocks
+      const auto to = elements.push_back( mapper.get_to_id( ), mapper.get_to_node_count( ), count );
+
+      parallel_for_blocks( threads_, count, size_t( 1 ) << 16, [ & ]( size_t begin, size_t end ) {
+        mapper.map( element_set, begin, end, to );
+      } );
+    }
+
+    // The attributes need the selections, which follow the element sets
+    if ( auto* domain_ids = disposable( element_set.geometric_indicies ) )
+    {
+      parts.domain_ids.push_back( std::move( *domain_ids ) );
+    }
+    else
+    {
+      parts.domain_ids.push_back( geometry_set );
+    }
+    return;
+  }
+
+  iter = boundary_mappers.find( elementNameId );
+
+  if ( iter == boundary_mappers.end( ) )
+  {
+    std_clog.print( message_prefix_,
+                    "Warning: Element with Comsol id name: ",
+                    elementNameId,
+                    " is not currently supported." );
+    return;
+  }
+
+  const auto& mapper = iter->second;
+
+  std_clog.print(
+    "Comsol type id: ", elementNameId, " to Aero surfacetopo type id: ", mapper.get_to_id( ) );
+  std_clog.print( "  Number of faces: ", geometry_set.size( ) );
+
+  check_node_count( element_set, mapper );
+
+  auto& surface_topologies = aero_mesh.surface_topologies;
+
+  // The faces of each geometric entity are appended to its topology as one block
+  const GeometricEntityIndex< Index > entity_index( geometry_set );
+  const size_t                        node_count = mapper.get_to_node_count( );
+
+  // Topologies are created in the order their entities first appear, finish_parts() sorts them
+  std::vector< size_t > surface_entities;
+
+  for ( size_t entity = 0; entity != entity_index.size( ); entity++ )
+  {
+    if ( entity_index.elements( entity ).size( ) == 0 )
+    {
+      continue;
+    }
+
+    if ( prefixes.size( ) != 0 && entity >= prefixes.size( ) )
+    {
+      throw std::invalid_argument(
+        "Comsol geometry contains more surfaces than the number of surface names provided." );
+    }
+
+    if ( entity >= parts.topology_of_entity.size( ) )
+    {
+      parts.topology_of_entity.resize( entity + 1, numeric_limits< size_t >::max( ) );
+    }
+
+    if ( parts.topology_of_entity[ entity ] == numeric_limits< size_t >::max( ) )
+    {
+      parts.topology_of_entity[ entity ] = surface_topologies.size( );
+
+      typename AeroMesh::TopologyId id( prefixes.size( ) != 0 ? prefixes[ entity ] : string( ),
+                                        entity + 1 );
+
+      surface_topologies.emplace_back( std::move( id ), typename AeroMesh::Elements( ) );
+    }
+    surface_entities.push_back( entity );
+  }
+
+  // Every topology is written by one task only
+  parallel_for( threads_, surface_entities.size( ), [ & ]( size_t e ) {
+    const auto entity = surface_entities[ e ];
+    const auto faces  = entity_index.elements( entity );
+
+    auto to = surface_topologies[ parts.topology_of_entity[ entity ] ].second.push_back(
+      mapper.get_to_id( ), node_count, faces.size( ) );
+
+    for ( size_t k = 0; k != faces.size( ); k++ )
+    {
+      mapper.map( element_set[ faces[ k ] ],
+                  Span< Index >( to.data( ) + k * node_count, node_count ) );
+    }
+  } );
+}
+
+template< class Index >
+void BasicConverter< Index >::finish_parts(
+  const typename ComsolMesh::SelectionObjects& selection_objects,
+  Parts&                                       parts,
+  AeroMesh&                                    aero_mesh ) const
+{
+  std::size_t attribute_overwrites = 0;
+  std::size_t not_assigned         = 0;
+
+  // Without selections the attributes are the comsol domain ids
+  const bool domain_ids = !selections_to_attributes || selection_objects.empty( );
+
+  for ( auto& geometry_set : parts.domain_ids )
+  {
+    if ( domain_ids && aero_mesh.attributes.empty( ) )
+    {
+      if ( selections_to_attributes )
+      {
+        not_assigned += geometry_set.size( );
+      }
+      aero_mesh.attributes = std::move( geometry_set );
+    }
+    else if ( !selections_to_attributes )
+    {
+      copy( geometry_set.begin( ), geometry_set.end( ), back_inserter( aero_mesh.attributes ) );
+    }
+    else
+    {
+      map_3d_comsol_selections_to_aero_attributes(
+        selection_objects, aero_mesh, attribute_overwrites, geometry_set, not_assigned );
+    }
+    typename Parts::GeometricIndicies( ).swap( geometry_set );
+  }
+
+  for ( size_t i = 0; i != parts.element_sets; i++ )
+  {
+    push_attribute_labels( selection_objects, aero_mesh );
+  }
+
+  // Topologies are sorted by prefix, then by id
+  auto& surface_topologies = aero_mesh.surface_topologies;
+
+  std::sort( surface_topologies.begin( ),
+             surface_topologies.end( ),
+             []( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+  for ( size_t t = 0; t != surface_topologies.size( ); t++ )
+  {
+    parts.topology_of_entity[ surface_topologies[ t ].first.second - 1 ] = t;
+  }
+
+  map_surface_selections( selection_objects, parts.topology_of_entity, aero_mesh );
+
+  check_attributes( selection_objects, attribute_overwrites, not_assigned );
+}
+
+template class BasicConverter< std::size_t >;
+#ifdef COMSOL2AERO_32BIT_INDICES
+template class BasicConverter< std::uint32_t >;
+#endif
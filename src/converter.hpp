@@ -46,8 +46,9 @@
 #include "comsolmesh.hpp"
 #include "config.hpp"
 
+#include <algorithm>
 #include <array>
-#include <memory>
+#include <utility>
 
 namespace detail
 {
@@ -81,72 +82,141 @@ static std::array< detail::supportedType, 8 > hex_supported = {
 /*! \brief Maps elements one mesh format to another.
  *
  *
- *  This is an abstract base class. get_to_id() member reflects the ID of the
- *  element in the converted mesh.
+ *  get_to_id() member reflects the ID of the element in the converted mesh.
+ *  The node permutation is a kernel that maps a whole block of elements per
+ *  call. Index is the type of the node indices.
  */
-template< class TOID >
+template< class Index >
 class ElementMapper
 {
 public:
-  ElementMapper( size_t to ) : to_node_count_( to )
+  //! Maps count elements of stride nodes each, starting at from, into to.
+  using Kernel = void ( * )( const Index* from, size_t stride, size_t count, Index* to );
+
+  ElementMapper( ) = default;
+
+  ElementMapper( size_t to_id, size_t from, size_t to, Kernel kernel ) :
+    to_id_( to_id ), from_node_count_( from ), to_node_count_( to ), kernel_( kernel )
   {
   }
 
-  virtual const TOID& get_to_id( ) const = 0;
+  const size_t& get_to_id( ) const
+  {
+    return to_id_;
+  }
 
-  aero::Mesh::Connectivity map( const comsol::ElementSet::Element& element ) const
+  //! Number of nodes of the converted element
+  size_t get_to_node_count( ) const
   {
-    aero::Mesh::Connectivity con;
-    con.reserve( element.size( ) );
+    return to_node_count_;
+  }
 
-    for ( size_t k = 0; k != to_node_count_; k++ )
-    {
-      con.push_back( element[ map( k ) ] + 1 );
-    }
-    return con;
+  //! Minimum number of nodes of the elements that are mapped
+  size_t get_from_node_count( ) const
+  {
+    return from_node_count_;
   }
 
-protected:
-  virtual const size_t& map( size_t i ) const = 0;
+  //! Writes the converted nodes of element into the get_to_node_count() slots of con.
+  void map( const typename comsol::BasicElementSet< Index >::Element& element,
+            Span< Index >                                             con ) const
+  {
+    kernel_( element.data( ), element.size( ), 1, con.data( ) );
+  }
 
-  size_t to_node_count_;
-};
+  //! Writes the converted nodes of every element of set into con, one element after the other.
+  void map( const comsol::BasicElementSet< Index >& set, Span< Index > con ) const
+  {
+    kernel_( set.connectivity.data( ), set.nodes_per_element, set.size( ), con.data( ) );
+  }
+
+  //! Writes the converted nodes of elements [first, last) of set into con.
+  void map( const comsol::BasicElementSet< Index >& set,
+            size_t                                  first,
+            size_t                                  last,
+            Span< Index >                           con ) const
+  {
+    kernel_( set.connectivity.data( ) + first * set.nodes_per_element,
+             set.nodes_per_element,
+             last - first,
+             con.data( ) + first * to_node_count_ );
+  }
 
-typedef ElementMapper< size_t > ComsolToAeroElementMapperBase;
+  /*! \brief Converts elements [first, last) of con in place.
+   *
+   *  The elements are stored with get_to_node_count() nodes each, which must
+   *  also be the number of nodes of the comsol elements.
+   */
+  void map_in_place( Span< Index > con, size_t first, size_t last ) const
+  {
+    Index* nodes = con.data( ) + first * to_node_count_;
+
+    kernel_( nodes, to_node_count_, last - first, nodes );
+  }
+
+private:
+  size_t to_id_           = 0;
+  size_t from_node_count_ = 0;
+  size_t to_node_count_   = 0;
+  Kernel kernel_          = nullptr;
+};
 
 /*! \brief Maps elements from comsol to aero.
  *
  *
- *  The get_to_id() member has a generic implementation that allows
- *  for setting the converted element id at object construction time.
- *
- *  The mapping is defined by a static array that most compilers should
- *  construct in compile time.
+ *  Node k of the aero element is node mappings[k] of the comsol element, plus
+ *  one. The permutation is known at compile time, so the per element code is
+ *  a fixed sequence of loads and stores that compilers unroll and, for small
+ *  arities, vectorize into shuffles. mapper() builds the ElementMapper for a
+ *  given aero element id.
  */
-template< size_t... mappings >
-class ComsolToAeroElementMapper : public ComsolToAeroElementMapperBase
+template< class Index, size_t... mappings >
+struct ComsolToAeroElementMapper
 {
-public:
-  ComsolToAeroElementMapper( size_t aeroID ) :
-    ComsolToAeroElementMapperBase( sizeof...( mappings ) ), aeroID_( aeroID )
-  {
-  }
+  static constexpr std::array< std::size_t, sizeof...( mappings ) > node_mapping {
+    { mappings... }
+  };
 
-  const size_t& get_to_id( ) const
+  static constexpr size_t to_node_count = sizeof...( mappings );
+
+  static constexpr size_t from_node_count = std::max( { mappings... } ) + 1;
+
+  static ElementMapper< Index > mapper( size_t aeroID )
   {
-    return aeroID_;
+    return ElementMapper< Index >( aeroID, from_node_count, to_node_count, &map_block );
   }
 
-protected:
-  const size_t& map( size_t i ) const
+  static void map_block( const Index* from, size_t stride, size_t count, Index* to )
   {
-    return node_mapping[ i ];
+    if ( stride == from_node_count ) // Compile time stride for the usual first order elements
+    {
+      for ( size_t i = 0; i != count; i++ )
+      {
+        permute( from + i * from_node_count,
+                 to + i * to_node_count,
+                 std::make_index_sequence< to_node_count >( ) );
+      }
+    }
+    else
+    {
+      for ( size_t i = 0; i != count; i++ )
+      {
+        permute(
+          from + i * stride, to + i * to_node_count, std::make_index_sequence< to_node_count >( ) );
+      }
+    }
   }
 
 private:
-  std::size_t aeroID_;
+  // All nodes are loaded before any is stored, so that the compiler need not assume that from
+  // and to overlap and can use vector shuffles.
+  template< size_t... k >
+  static void permute( const Index* from, Index* to, std::index_sequence< k... > )
+  {
+    const Index nodes[] = { static_cast< Index >( from[ node_mapping[ k ] ] + 1 )... };
 
-  std::array< std::size_t, sizeof...( mappings ) > node_mapping { { mappings... } };
+    ( ( to[ k ] = nodes[ k ] ), ... );
+  }
 };
 
 /*! \brief The mesh Converter
@@ -154,22 +224,72 @@ private:
  *
  *  The Converter will convert a comsol mesh to an aero mesh, given certain
  *  mapping options that define what will be the type id in aero of certain
- *  comsol element types.
+ *  comsol element types. Index is the type of the node indices of both
+ *  meshes. Elements, attributes and surface faces are converted by up to
+ *  threads threads; the result does not depend on the number of threads.
+ *  Warnings are written to the standard error starting with message_prefix,
+ *  e.g. the job of a batch they come from.
  */
-class Converter
+template< class Index >
+class BasicConverter
 {
 public:
-  Converter( bool                                        verb,
-             bool                                        associate_selections_with_attributes,
-             const std::map< std::string, std::size_t >& mapping_options,
-             const std::vector< std::string >&           pr,
-             const std::vector< std::string >&           accepted_selections );
-
-  void convert( const comsol::Mesh& comsol_mesh, aero::Mesh& aero_mesh ) const;
+  using ComsolMesh = comsol::BasicMesh< Index >;
+  using AeroMesh   = aero::BasicMesh< Index >;
+
+  BasicConverter( bool                                        verb,
+                  bool                                        associate_selections_with_attributes,
+                  const std::map< std::string, std::size_t >& mapping_options,
+                  const std::vector< std::string >&           pr,
+                  const std::vector< std::string >&           accepted_selections,
+                  std::size_t                                 threads        = 1,
+                  const std::string&                          message_prefix = "" );
+
+  void convert( const ComsolMesh& comsol_mesh, AeroMesh& aero_mesh ) const;
+
+  /*! \brief Converts a comsol mesh that is no longer needed.
+   *
+   *
+   *  The element sets are converted with convert_part() and finish_parts()
+   *  and released as soon as each has been converted. The aero mesh takes
+   *  over the coordinates and the connectivity of the first domain element
+   *  set, which is converted in place, and its geometric indices become the
+   *  attributes if there are no selections. The peak memory is then about
+   *  that of one mesh plus one element set.
+   */
+  void convert( ComsolMesh&& comsol_mesh, AeroMesh& aero_mesh ) const;
+
+  //! What a mesh converted part by part keeps between convert_part() and finish_parts()
+  struct Parts
+  {
+    using GeometricIndicies = typename comsol::BasicElementSet< Index >::GeometricIndicies;
+
+    std::vector< GeometricIndicies > domain_ids;         // Of each domain element set, in order
+    std::vector< std::size_t >       topology_of_entity; // Position in surface_topologies
+    std::size_t                      element_sets = 0;
+  };
+
+  /*! \brief Converts one element set of a mesh whose parts are converted as
+   *  soon as they are parsed.
+   *
+   *
+   *  The converted domain elements are returned instead of being added to
+   *  aero_mesh, so that they can be written and released; the element sets
+   *  must be converted in order. The faces of surface element sets are
+   *  added to the surface topologies of aero_mesh, which finish_parts()
+   *  sorts and completes with the attributes.
+   */
+  typename AeroMesh::Elements convert_part( comsol::BasicElementSet< Index >&& element_set,
+                                            Parts&                             parts,
+                                            AeroMesh&                          aero_mesh ) const;
+
+  //! Completes a mesh converted part by part, once all its element sets are converted
+  void finish_parts( const typename ComsolMesh::SelectionObjects& selection_objects,
+                     Parts&                                       parts,
+                     AeroMesh&                                    aero_mesh ) const;
 
 private:
-  using MapperPtr = std::shared_ptr< ComsolToAeroElementMapperBase >;
-  using Mappers = std::map< std::string, MapperPtr >;
+  using Mappers = std::map< std::string, ElementMapper< Index > >;
 
   bool selections_to_attributes = true;
 
@@ -177,25 +297,56 @@ private:
   Mappers                  domain_mappers;
   std::vector< std::string > prefixes;
   std::vector< std::string > accepted_selections_;
+  std::size_t                threads_;
+  std::string                message_prefix_;
 
   CharStreamer< std::ostream > std_clog;
+  CharStreamer< std::ostream > std_cerr; // Warnings
 #ifdef NDEBUG
   NoneCharStreamer< std::ostream > debug_stdout;
 #else
   char_streamer< std::ostream > debugstdout;
 #endif
 
+  // Converts comsol_mesh, consuming it unless Mesh is const
+  template< class Mesh >
+  void convert_mesh( Mesh& comsol_mesh, AeroMesh& aero_mesh ) const;
+
+  // Converts one element set, consuming it unless Set is const. The domain elements are added to
+  // elements, the surface faces to aero_mesh.
+  template< class Set >
+  void convert_set( Set&                         element_set,
+                    Parts&                       parts,
+                    typename AeroMesh::Elements& elements,
+                    AeroMesh&                    aero_mesh ) const;
+
   void map_3d_comsol_selections_to_aero_attributes(
-    const comsol::Mesh::SelectionObjects&        selection_objects,
-    aero::Mesh&                                  aero_mesh,
-    std::size_t&                                 attribute_overwrites,
-    const comsol::ElementSet::GeometricIndicies& geometry_set,
-    std::size_t&                                 not_assigned ) const;
+    const typename ComsolMesh::SelectionObjects&                        selection_objects,
+    AeroMesh&                                                           aero_mesh,
+    std::size_t&                                                        attribute_overwrites,
+    const typename comsol::BasicElementSet< Index >::GeometricIndicies& geometry_set,
+    std::size_t&                                                        not_assigned ) const;
+
+  // Adds the labels of the attributes of one element set
+  void push_attribute_labels( const typename ComsolMesh::SelectionObjects& selection_objects,
+                              AeroMesh&                                    aero_mesh ) const;
+
+  // Adds the selections of surfaces, referencing the topology of each geometric entity
+  void map_surface_selections( const typename ComsolMesh::SelectionObjects& selection_objects,
+                               const std::vector< std::size_t >&            topology_of_entity,
+                               AeroMesh&                                    aero_mesh ) const;
+
+  // Warns about the attributes that are overwritten or not assigned a selection
+  void check_attributes( const typename ComsolMesh::SelectionObjects& selection_objects,
+                         std::size_t                                  attribute_overwrites,
+                         std::size_t                                  not_assigned ) const;
 
   void map_comsol_surface_selections_to_aero_surfacetopo(
-    const comsol::Mesh::SelectionObjects& selection_objects,
-    aero::Mesh&                           aero_mesh,
-    const comsol::ElementSet&             geometry_set ) const;
+    const typename ComsolMesh::SelectionObjects& selection_objects,
+    AeroMesh&                                    aero_mesh,
+    const comsol::BasicElementSet< Index >&      geometry_set ) const;
 };
 
+using Converter = BasicConverter< std::size_t >;
+
 #endif // CONVERTER_H
@@ -0,0 +1,346 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef COORDINATES_HPP
+#define COORDINATES_HPP
+
+#include "spillallocator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/*! \brief Contiguous storage of the mesh point coordinates.
+ *
+ *
+ *  All coordinates live in one space_dimensions * size() buffer, either
+ *  interleaved per point (x0 y0 z0 x1 ...) or blocked per dimension
+ *  (x0 x1 ... y0 y1 ...). The default layout is interleaved and is switched
+ *  to blocked by building with COMSOL2AERO_COORDINATES_SOA.
+ *
+ *  Copies share the same buffer, so handing the parsed coordinates over to
+ *  the aero mesh does not duplicate them. The buffer is copied on write:
+ *  writing a value through coordinates whose buffer is shared first gives
+ *  them a buffer of their own, so that the other copies do not change.
+ */
+class Coordinates
+{
+public:
+  enum class Layout
+  {
+    interleaved, // Array of structures
+    blocked      // Structure of arrays
+  };
+
+#ifdef COMSOL2AERO_COORDINATES_SOA
+  static constexpr Layout default_layout = Layout::blocked;
+#else
+  static constexpr Layout default_layout = Layout::interleaved;
+#endif
+
+  /*! \brief Strided view of the coordinates of one point.
+   */
+  class Point
+  {
+  public:
+    class const_iterator
+    {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type        = double;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const double*;
+      using reference         = const double&;
+
+      const_iterator( ) = default;
+
+      const_iterator( const double* x, std::size_t stride ) : x_( x ), stride_( stride )
+      {
+      }
+
+      reference operator*( ) const
+      {
+        return *x_;
+      }
+
+      const_iterator& operator++( )
+      {
+        x_ += stride_;
+        return *this;
+      }
+
+      const_iterator operator++( int )
+      {
+        const_iterator old = *this;
+        x_ += stride_;
+        return old;
+      }
+
+      bool operator==( const const_iterator& other ) const
+      {
+        return x_ == other.x_;
+      }
+
+      bool operator!=( const const_iterator& other ) const
+      {
+        return x_ != other.x_;
+      }
+
+    private:
+      const double* x_      = nullptr;
+      std::size_t   stride_ = 1;
+    };
+
+    using value_type      = double;
+    using size_type       = std::size_t;
+    using reference       = const double&;
+    using const_reference = const double&;
+    using iterator        = const_iterator;
+
+    Point( ) = default;
+
+    Point( const double* x, std::size_t size, std::size_t stride ) :
+      x_( x ), size_( size ), stride_( stride )
+    {
+    }
+
+    const_iterator begin( ) const
+    {
+      return const_iterator( x_, stride_ );
+    }
+
+    const_iterator end( ) const
+    {
+      return const_iterator( x_ + size_ * stride_, stride_ );
+    }
+
+    std::size_t size( ) const
+    {
+      return size_;
+    }
+
+    const double& operator[]( std::size_t d ) const
+    {
+      return x_[ d * stride_ ];
+    }
+
+  private:
+    const double* x_      = nullptr;
+    std::size_t   size_   = 0;
+    std::size_t   stride_ = 1;
+  };
+
+  class const_iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = Point;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const Point*;
+    using reference         = Point;
+
+    const_iterator( ) = default;
+
+    const_iterator( const Coordinates* coords, std::size_t i ) : coords_( coords ), i_( i )
+    {
+    }
+
+    Point operator*( ) const
+    {
+      return ( *coords_ )[ i_ ];
+    }
+
+    const_iterator& operator++( )
+    {
+      ++i_;
+      return *this;
+    }
+
+    const_iterator operator++( int )
+    {
+      const_iterator old = *this;
+      ++i_;
+      return old;
+    }
+
+    bool operator==( const const_iterator& other ) const
+    {
+      return i_ == other.i_;
+    }
+
+    bool operator!=( const const_iterator& other ) const
+    {
+      return i_ != other.i_;
+    }
+
+  private:
+    const Coordinates* coords_ = nullptr;
+    std::size_t        i_      = 0;
+  };
+
+  using value_type      = Point;
+  using size_type       = std::size_t;
+  using reference       = Point;
+  using const_reference = Point;
+  using iterator        = const_iterator;
+
+  Coordinates( Layout layout = default_layout ) : layout_( layout )
+  {
+  }
+
+  Layout layout( ) const
+  {
+    return layout_;
+  }
+
+  std::size_t dimension( ) const
+  {
+    return dimension_;
+  }
+
+  //! Number of points
+  std::size_t size( ) const
+  {
+    return size_;
+  }
+
+  bool empty( ) const
+  {
+    return size_ == 0;
+  }
+
+  void clear( )
+  {
+    values_.reset( );
+    size_ = 0;
+  }
+
+  /*! \brief Resizes to points of dimension values each, keeping the
+   *  coordinates of the points that remain.
+   */
+  void resize( std::size_t dimension, std::size_t points )
+  {
+    auto values = std::make_shared< SpillVector< double > >( dimension * points );
+
+    if ( values_ && dimension == dimension_ )
+    {
+      const std::size_t kept = std::min( points, size_ );
+
+      if ( layout_ == Layout::interleaved )
+      {
+        std::copy( values_->begin( ), values_->begin( ) + kept * dimension, values->begin( ) );
+      }
+      else
+      {
+        for ( std::size_t d = 0; d != dimension; d++ )
+        {
+          std::copy( values_->begin( ) + d * size_,
+                     values_->begin( ) + d * size_ + kept,
+                     values->begin( ) + d * points );
+        }
+      }
+    }
+    values_    = std::move( values );
+    dimension_ = dimension;
+    size_      = points;
+  }
+
+  //! Coordinate d of point i, see copy on write above
+  double& operator( )( std::size_t i, std::size_t d )
+  {
+    unshare( );
+    return ( *values_ )[ offset( i, d ) ];
+  }
+
+  const double& operator( )( std::size_t i, std::size_t d ) const
+  {
+    return ( *values_ )[ offset( i, d ) ];
+  }
+
+  Point operator[]( std::size_t i ) const
+  {
+    return Point( values_->data( ) + offset( i, 0 ), dimension_, stride( ) );
+  }
+
+  const_iterator begin( ) const
+  {
+    return const_iterator( this, 0 );
+  }
+
+  const_iterator end( ) const
+  {
+    return const_iterator( this, size_ );
+  }
+
+  //! Raw buffer, in the order given by layout()
+  const double* data( ) const
+  {
+    return values_ ? values_->data( ) : nullptr;
+  }
+
+private:
+  // Copies the buffer before a write if other coordinates share it. The values of the same
+  // coordinates are written concurrently only while their buffer is not shared, e.g. parsing.
+  void unshare( )
+  {
+    if ( values_.use_count( ) > 1 )
+    {
+      values_ = std::make_shared< SpillVector< double > >( *values_ );
+    }
+  }
+
+  std::size_t stride( ) const
+  {
+    return layout_ == Layout::interleaved ? 1 : size_;
+  }
+
+  std::size_t offset( std::size_t i, std::size_t d ) const
+  {
+    return layout_ == Layout::interleaved ? i * dimension_ + d : d * size_ + i;
+  }
+
+  std::shared_ptr< SpillVector< double > > values_;
+  Layout                                   layout_;
+  std::size_t                              dimension_ = 0;
+  std::size_t                              size_      = 0;
+};
+
+#endif // COORDINATES_HPP
@@ -38,12 +38,13 @@
 // third parties. These are available on an "as is" basis and subject to their individual license
 // agreements. Additional information can be found in the provided "licenses" folder.
 
-#include "aerofgenerator.hpp"
-#include "aerosgenerator.hpp"
+#include "batch.hpp"
+#include "charstreamer.hpp"
 #include "cmdlineparse.hpp"
-#include "comsolparser.hpp"
 #include "config.hpp"
-#include "converter.hpp"
+#include "conversion.hpp"
+#include "memoryusage.hpp"
+#include "spillallocator.hpp"
 
 #include <iostream>
 
@@ -61,52 +62,36 @@ int main( int ac, char* av[] )
       return 0;
     }
 
-    comsol::Parser Parser( options.verbose );
+    CharStreamer< ostream > stdclog( clog, options.verbose );
 
-    if ( options.input_file_name == "" )
-    {
-      Parser.parse( std::cin );
-    }
-    else
-    {
-      Parser.parse( options.input_file_name );
-    }
+    // Reports the peak memory of each phase in verbose mode
+    const auto phase_completed = [ & ]( const char* phase ) {
+      stdclog.print( "Peak memory while ", phase, ": ", peak_memory( ) / 1.e6, " MB" );
+      reset_peak_memory( );
 
-    aero::Mesh aeroMesh;
-    Converter    conv( options.verbose,
-                    options.use_selections,
-                    options.element_mapping,
-                    options.surface_name_prefixes,
-                    options.accepted_selections );
+      if ( options.memory_limit != 0 )
+      {
+        stdclog.print( "Mapped from temporary files: ", spilled_memory( ) / 1.e6, " MB" );
+      }
+    };
 
-    conv.convert( Parser.getModel( ), aeroMesh );
+    set_memory_limit( options.memory_limit * 1000000 );
+    set_spill_directory( options.spill_directory );
+    reset_peak_memory( );
 
-    if ( options.aerof == false )
+    if ( options.memory_limit != 0 && spill_directory_in_memory( ) )
     {
-      aeros::Generator generator( options.verbose, options.matusage, aeroMesh );
-
-      if ( options.output_file_name == "" )
-      {
-        generator.generate( std::cout );
-      }
-      else
-      {
-        generator.generate( options.output_file_name );
-      }
+      cerr << "comsol2aero: Warning: " + spill_directory( )
+                + " is held in memory, mapping the arrays beyond --memory-limit from it saves no "
+                  "memory. Choose a directory on disk with --spill-dir.\n";
     }
-    else
-    {
-      aerof::Generator generator( options.verbose, aeroMesh );
 
-      if ( options.output_file_name == "" )
-      {
-        generator.generate( std::cout );
-      }
-      else
-      {
-        generator.generate( options.output_file_name );
-      }
+    if ( options.batch_file_name != "" )
+    {
+      return run_batch( options ) ? 0 : 1;
     }
+
+    convert( options, phase_completed );
   }
   catch ( exception& e )
   {
@@ -0,0 +1,155 @@
+#include "mappedfile.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _MSC_VER // FIXME: HAS NOT BEEN TESTED
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+MappedFile::MappedFile( const std::string& file_name )
+{
+  HANDLE file = CreateFileA( file_name.c_str( ),
+                             GENERIC_READ,
+                             FILE_SHARE_READ,
+                             nullptr,
+                             OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                             nullptr );
+
+  if ( file == INVALID_HANDLE_VALUE )
+  {
+    std::stringstream ss;
+    ss << "Could not open file " << file_name << " for parsing.";
+
+    throw std::runtime_error( ss.str( ) );
+  }
+
+  file_ = file;
+
+  LARGE_INTEGER size;
+  if ( GetFileType( file ) != FILE_TYPE_DISK || !GetFileSizeEx( file, &size ) )
+  {
+    return;
+  }
+
+  size_   = static_cast< std::size_t >( size.QuadPart );
+  mapped_ = true;
+
+  if ( size_ == 0 ) // Empty files cannot be mapped.
+  {
+    return;
+  }
+
+  mapping_ = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+  if ( mapping_ != nullptr )
+  {
+    data_ = static_cast< const char* >( MapViewOfFile( mapping_, FILE_MAP_READ, 0, 0, 0 ) );
+  }
+
+  if ( data_ == nullptr )
+  {
+    size_   = 0;
+    mapped_ = false;
+  }
+}
+
+MappedFile::~MappedFile( )
+{
+  if ( data_ )
+  {
+    UnmapViewOfFile( data_ );
+  }
+  if ( mapping_ )
+  {
+    CloseHandle( mapping_ );
+  }
+  if ( file_ )
+  {
+    CloseHandle( file_ );
+  }
+}
+
+void MappedFile::release( const char*, const char* ) const
+{
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile( const std::string& file_name )
+{
+  int fd = open( file_name.c_str( ), O_RDONLY );
+
+  if ( fd == -1 )
+  {
+    std::stringstream ss;
+    ss << "Could not open file " << file_name << " for parsing.";
+
+    throw std::runtime_error( ss.str( ) );
+  }
+
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) )
+  {
+    close( fd );
+    return;
+  }
+
+  size_   = static_cast< std::size_t >( st.st_size );
+  mapped_ = true;
+
+  if ( size_ != 0 ) // Empty files cannot be mapped.
+  {
+    void* addr = mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+    if ( addr == MAP_FAILED )
+    {
+      size_   = 0;
+      mapped_ = false;
+    }
+    else
+    {
+      data_ = static_cast< const char* >( addr );
+
+      // Hints only, failures are harmless.
+      madvise( addr, size_, MADV_SEQUENTIAL );
+#ifdef MADV_HUGEPAGE
+      madvise( addr, size_, MADV_HUGEPAGE );
+#endif
+    }
+  }
+
+  close( fd ); // The mapping keeps its own reference to the file.
+}
+
+MappedFile::~MappedFile( )
+{
+  if ( data_ )
+  {
+    munmap( const_cast< char* >( data_ ), size_ );
+  }
+}
+
+void MappedFile::release( const char* first, const char* last ) const
+{
+  const std::uintptr_t page = static_cast< std::uintptr_t >( sysconf( _SC_PAGESIZE ) );
+
+  const std::uintptr_t begin = ( reinterpret_cast< std::uintptr_t >( first ) + page - 1 ) / page;
+  const std::uintptr_t end   = reinterpret_cast< std::uintptr_t >( last ) / page;
+
+  if ( begin < end )
+  {
+    // A hint only, failures are harmless.
+    madvise( reinterpret_cast< void* >( begin * page ), ( end - begin ) * page, MADV_DONTNEED );
+  }
+}
+
+#endif
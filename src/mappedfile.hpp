@@ -0,0 +1,105 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/*! \brief Read only memory mapping of an input file.
+ *
+ *
+ *  The whole file is mapped into the address space of the process so that the
+ *  parsers can operate directly on the file contents without an intermediate
+ *  copy. The kernel is advised that the mapping will be read sequentially.
+ *
+ *  If the file cannot be mapped (i.e. it is not a regular file, such as a
+ *  named pipe) is_mapped() returns false and the caller is expected to fall
+ *  back to stream based reading.
+ */
+class MappedFile
+{
+public:
+  MappedFile( const std::string& file_name );
+  ~MappedFile( );
+
+  MappedFile( const MappedFile& ) = delete;
+  MappedFile& operator=( const MappedFile& ) = delete;
+
+  bool is_mapped( ) const
+  {
+    return mapped_;
+  }
+
+  const char* begin( ) const
+  {
+    return data_;
+  }
+
+  const char* end( ) const
+  {
+    return data_ + size_;
+  }
+
+  std::size_t size( ) const
+  {
+    return size_;
+  }
+
+  /*! \brief Drops the whole pages of [first, last) from the memory of the
+   *  process, where the platform supports it.
+   *
+   *  The contents stay valid: pages accessed again are read back from the
+   *  file.
+   */
+  void release( const char* first, const char* last ) const;
+
+private:
+  const char* data_   = nullptr;
+  std::size_t size_   = 0;
+  bool        mapped_ = false;
+
+#ifdef _MSC_VER
+  void* file_    = nullptr;
+  void* mapping_ = nullptr;
+#endif
+};
+
+#endif // MAPPEDFILE_HPP
@@ -0,0 +1,75 @@
+#include "memoryusage.hpp"
+
+#if defined( _MSC_VER ) // FIXME: HAS NOT BEEN TESTED
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+#include <psapi.h>
+
+std::size_t peak_memory( )
+{
+  PROCESS_MEMORY_COUNTERS counters;
+
+  if ( !K32GetProcessMemoryInfo( GetCurrentProcess( ), &counters, sizeof( counters ) ) )
+  {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+}
+
+void reset_peak_memory( )
+{
+}
+
+#elif defined( __linux__ )
+
+#include <fstream>
+#include <string>
+
+std::size_t peak_memory( )
+{
+  std::ifstream status( "/proc/self/status" );
+  std::string   line;
+
+  while ( std::getline( status, line ) )
+  {
+    if ( line.compare( 0, 6, "VmHWM:" ) == 0 )
+    {
+      return std::stoull( line.substr( 6 ) ) * 1024; // In kB
+    }
+  }
+  return 0;
+}
+
+void reset_peak_memory( )
+{
+  // Resets VmHWM to the current resident memory, ignored by kernels older than 4.0
+  std::ofstream clear_refs( "/proc/self/clear_refs" );
+  clear_refs << "5";
+}
+
+#else
+
+#include <sys/resource.h>
+
+std::size_t peak_memory( )
+{
+  rusage usage;
+
+  if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+  {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss; // In bytes
+#else
+  return usage.ru_maxrss * std::size_t( 1024 ); // In kB
+#endif
+}
+
+void reset_peak_memory( )
+{
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include "outputbuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _MSC_VER // FIXME: HAS NOT BEEN TESTED
+
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+
+namespace
+{
+int open_for_writing( const std::string& file_name )
+{
+  return _open(
+    file_name.c_str( ), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE );
+}
+
+long long write_some( int fd, const char* data, std::size_t size )
+{
+  return _write( fd, data, static_cast< unsigned >( std::min< std::size_t >( size, 1u << 30 ) ) );
+}
+
+void close_file( int fd )
+{
+  _close( fd );
+}
+} // namespace
+
+#else
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+int open_for_writing( const std::string& file_name )
+{
+  return open( file_name.c_str( ), O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+}
+
+long long write_some( int fd, const char* data, std::size_t size )
+{
+  ssize_t written;
+  do
+  {
+    written = ::write( fd, data, size );
+  } while ( written == -1 && errno == EINTR );
+
+  return written;
+}
+
+void close_file( int fd )
+{
+  close( fd );
+}
+} // namespace
+
+#endif
+
+OutputBuffer::OutputBuffer( const std::string& file_name, std::size_t capacity ) :
+  data_( new char[ capacity ] ), next_( data_.get( ) ), end_( data_.get( ) + capacity ),
+  fd_( open_for_writing( file_name ) )
+{
+}
+
+OutputBuffer::OutputBuffer( std::ostream& stream, std::size_t capacity ) :
+  data_( new char[ capacity ] ), next_( data_.get( ) ), end_( data_.get( ) + capacity ),
+  stream_( &stream )
+{
+}
+
+OutputBuffer::~OutputBuffer( )
+{
+  if ( fd_ != -1 )
+  {
+    close_file( fd_ );
+  }
+}
+
+void OutputBuffer::write( const char* data, std::size_t size )
+{
+  while ( size != 0 )
+  {
+    if ( next_ == end_ )
+    {
+      flush( );
+    }
+
+    const std::size_t count = std::min( size, static_cast< std::size_t >( end_ - next_ ) );
+
+    std::memcpy( next_, data, count );
+    next_ += count;
+    data += count;
+    size -= count;
+  }
+}
+
+void OutputBuffer::flush( )
+{
+  const char*       data = data_.get( );
+  const std::size_t size = static_cast< std::size_t >( next_ - data );
+
+  if ( stream_ != nullptr )
+  {
+    if ( !stream_->write( data, static_cast< std::streamsize >( size ) ) )
+    {
+      throw std::runtime_error( "Writing the output failed." );
+    }
+  }
+  else
+  {
+    for ( std::size_t done = 0; done != size; )
+    {
+      const long long written = write_some( fd_, data + done, size - done );
+
+      if ( written <= 0 )
+      {
+        throw std::runtime_error( "Writing the output failed." );
+      }
+      done += static_cast< std::size_t >( written );
+    }
+  }
+
+  flushed_ += size;
+  next_ = data_.get( );
+}
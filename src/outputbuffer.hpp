@@ -0,0 +1,169 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef OUTPUTBUFFER_HPP
+#define OUTPUTBUFFER_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+
+/*! \brief Fixed size output buffer, flushed to a file or a stream as it fills.
+ *
+ *
+ *  The generators write through iterator() one character at a time, so the
+ *  memory used for output does not depend on the size of the mesh. Data still
+ *  in the buffer is written by flush(), which must be called once generation
+ *  succeeded; the destructor discards it.
+ */
+class OutputBuffer
+{
+public:
+  static constexpr std::size_t default_capacity = std::size_t( 1 ) << 20;
+
+  //! Output iterator that appends to the buffer
+  class iterator
+  {
+  public:
+    using iterator_category = std::output_iterator_tag;
+    using value_type        = void;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = void;
+    using reference         = void;
+
+    explicit iterator( OutputBuffer& buffer ) : buffer_( &buffer )
+    {
+    }
+
+    iterator& operator*( )
+    {
+      return *this;
+    }
+
+    iterator& operator=( char c )
+    {
+      buffer_->put( c );
+      return *this;
+    }
+
+    iterator& operator++( )
+    {
+      return *this;
+    }
+
+    iterator& operator++( int )
+    {
+      return *this;
+    }
+
+  private:
+    OutputBuffer* buffer_;
+  };
+
+  /*! \brief Creates or truncates the file file_name.
+   *
+   *  is_open() tells whether the file could be opened.
+   */
+  explicit OutputBuffer( const std::string& file_name, std::size_t capacity = default_capacity );
+
+  //! Writes to stream, which must outlive the buffer
+  explicit OutputBuffer( std::ostream& stream, std::size_t capacity = default_capacity );
+
+  ~OutputBuffer( );
+
+  OutputBuffer( const OutputBuffer& ) = delete;
+  OutputBuffer& operator=( const OutputBuffer& ) = delete;
+
+  bool is_open( ) const
+  {
+    return fd_ != -1 || stream_ != nullptr;
+  }
+
+  void put( char c )
+  {
+    if ( next_ == end_ )
+    {
+      flush( );
+    }
+    *next_++ = c;
+  }
+
+  void write( const char* data, std::size_t size );
+
+  /*! \brief Returns room for size characters, which must not exceed the capacity.
+   *
+   *  The characters written there are added by commit( last ), where last is
+   *  the end of the written characters.
+   */
+  char* reserve( std::size_t size )
+  {
+    if ( static_cast< std::size_t >( end_ - next_ ) < size )
+    {
+      flush( );
+    }
+    return next_;
+  }
+
+  void commit( char* last )
+  {
+    next_ = last;
+  }
+
+  //! Writes the buffered data. Throws std::runtime_error if the output fails.
+  void flush( );
+
+  //! Number of characters written so far, including the buffered ones
+  std::size_t size( ) const
+  {
+    return flushed_ + static_cast< std::size_t >( next_ - data_.get( ) );
+  }
+
+private:
+  std::unique_ptr< char[] > data_;
+  char*                     next_;
+  char*                     end_;
+  std::size_t               flushed_ = 0;
+
+  int           fd_     = -1;
+  std::ostream* stream_ = nullptr;
+};
+
+#endif // OUTPUTBUFFER_HPP
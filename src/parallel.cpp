@@ -0,0 +1,186 @@
+#include "parallel.hpp"
+
+ThreadPool& ThreadPool::shared( )
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+ThreadPool::~ThreadPool( )
+{
+  {
+    std::lock_guard< std::mutex > lock( mutex_ );
+    stop_ = true;
+  }
+  wake_.notify_all( );
+
+  for ( auto& worker : workers_ )
+  {
+    worker.join( );
+  }
+}
+
+void ThreadPool::run( std::size_t threads,
+                      std::size_t count,
+                      void ( *call )( void*, std::size_t ),
+                      void* f )
+{
+  Job job;
+  job.call      = call;
+  job.f         = f;
+  job.threads   = threads;
+  job.ranges    = std::unique_ptr< Range[] >( new Range[ threads ] );
+  job.pending   = count;
+  job.cancelled = false;
+
+  // Contiguous and balanced initial ranges
+  for ( std::size_t t = 0; t != threads; t++ )
+  {
+    job.ranges[ t ].begin = count * t / threads;
+    job.ranges[ t ].end   = count * ( t + 1 ) / threads;
+  }
+
+  {
+    std::lock_guard< std::mutex > lock( mutex_ );
+
+    while ( workers_.size( ) + 1 < threads )
+    {
+      workers_.emplace_back( &ThreadPool::work, this );
+    }
+
+    job.joined = 1; // The calling thread
+    job.users  = 1;
+    jobs_.push_back( &job );
+  }
+  wake_.notify_all( );
+
+  participate( job, 0 );
+
+  {
+    std::unique_lock< std::mutex > lock( mutex_ );
+
+    jobs_.erase( std::find( jobs_.begin( ), jobs_.end( ), &job ) );
+    job.users--;
+
+    done_.wait( lock, [ & ] { return job.users == 0; } );
+  }
+
+  if ( job.error )
+  {
+    std::rethrow_exception( job.error );
+  }
+}
+
+ThreadPool::Job* ThreadPool::open_job( ) const
+{
+  for ( auto job : jobs_ )
+  {
+    if ( job->joined != job->threads && job->pending != 0 && !job->cancelled )
+    {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void ThreadPool::work( )
+{
+  std::unique_lock< std::mutex > lock( mutex_ );
+
+  for ( ;; )
+  {
+    Job* job = nullptr;
+
+    wake_.wait( lock, [ & ] { return stop_ || ( job = open_job( ) ) != nullptr; } );
+
+    if ( stop_ )
+    {
+      return;
+    }
+
+    const std::size_t range = job->joined++;
+    job->users++;
+
+    lock.unlock( );
+    participate( *job, range );
+    lock.lock( );
+
+    if ( --job->users == 0 )
+    {
+      done_.notify_all( );
+    }
+  }
+}
+
+void ThreadPool::participate( Job& job, std::size_t range )
+{
+  std::size_t item = 0;
+
+  while ( !job.cancelled && ( take( job, range, item ) || steal( job, range, item ) ) )
+  {
+    job.pending--;
+
+    try
+    {
+      job.call( job.f, item );
+    }
+    catch ( ... )
+    {
+      std::lock_guard< std::mutex > lock( job.error_mutex );
+
+      if ( !job.error )
+      {
+        job.error = std::current_exception( );
+      }
+      job.cancelled = true;
+    }
+  }
+}
+
+bool ThreadPool::take( Job& job, std::size_t range, std::size_t& item )
+{
+  auto& own = job.ranges[ range ];
+
+  std::lock_guard< std::mutex > lock( own.mutex );
+
+  if ( own.begin == own.end )
+  {
+    return false;
+  }
+  item = own.begin++;
+  return true;
+}
+
+bool ThreadPool::steal( Job& job, std::size_t range, std::size_t& item )
+{
+  for ( std::size_t k = 1; k != job.threads; k++ )
+  {
+    auto& victim = job.ranges[ ( range + k ) % job.threads ];
+
+    std::size_t begin = 0;
+    std::size_t end   = 0;
+    {
+      std::lock_guard< std::mutex > lock( victim.mutex );
+
+      if ( victim.begin == victim.end )
+      {
+        continue;
+      }
+
+      // The back half, which the owner would reach last
+      begin      = victim.end - ( victim.end - victim.begin + 1 ) / 2;
+      end        = victim.end;
+      victim.end = begin;
+    }
+
+    auto& own = job.ranges[ range ];
+
+    std::lock_guard< std::mutex > lock( own.mutex );
+
+    own.begin = begin + 1;
+    own.end   = end;
+    item      = begin;
+    return true;
+  }
+  return false;
+}
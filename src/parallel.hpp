@@ -0,0 +1,251 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//! Resolves a user requested thread count. Zero selects the number of hardware threads.
+inline std::size_t resolve_thread_count( std::size_t threads )
+{
+  if ( threads == 0 )
+  {
+    threads = std::max( 1u, std::thread::hardware_concurrency( ) );
+  }
+  return threads;
+}
+
+/*! \brief A work-stealing pool of worker threads.
+ *
+ *
+ *  A loop handed to parallel_for() is split into one contiguous range of
+ *  items per participating thread. Each thread takes items from the front of
+ *  its own range and, once it is empty, steals the back half of the range of
+ *  another participant. The calling thread participates, so loops can be
+ *  nested: a thread waiting for a loop only waits for items that are being
+ *  processed.
+ *
+ *  Workers are started on demand and live until the pool is destroyed.
+ */
+class ThreadPool
+{
+public:
+  //! The pool shared by the whole program
+  static ThreadPool& shared( );
+
+  ThreadPool( ) = default;
+  ~ThreadPool( );
+
+  ThreadPool( const ThreadPool& ) = delete;
+  ThreadPool& operator=( const ThreadPool& ) = delete;
+
+  /*! \brief Calls f( i ) for every i in [0, count) using up to the given number of threads.
+   *
+   *  The first exception thrown by f is rethrown once no thread runs f any
+   *  more. Items that were not started by then are skipped.
+   */
+  template< typename F >
+  void parallel_for( std::size_t threads, std::size_t count, F& f )
+  {
+    run( threads, count, []( void* g, std::size_t i ) { ( *static_cast< F* >( g ) )( i ); }, &f );
+  }
+
+private:
+  struct Range
+  {
+    std::mutex  mutex;
+    std::size_t begin = 0;
+    std::size_t end   = 0;
+  };
+
+  struct Job
+  {
+    void ( *call )( void*, std::size_t );
+    void*                      f;
+    std::size_t                threads;
+    std::unique_ptr< Range[] > ranges;
+    std::size_t                joined = 0; // Guarded by the pool mutex
+    std::size_t                users  = 0; // Guarded by the pool mutex
+    std::atomic< std::size_t > pending;    // Items not taken yet
+    std::atomic< bool >        cancelled;
+    std::mutex                 error_mutex;
+    std::exception_ptr         error;
+  };
+
+  void run( std::size_t threads, std::size_t count, void ( *call )( void*, std::size_t ), void* f );
+
+  void work( );
+
+  static void participate( Job& job, std::size_t range );
+  static bool take( Job& job, std::size_t range, std::size_t& item );
+  static bool steal( Job& job, std::size_t range, std::size_t& item );
+
+  //! A job with items that no thread has taken, and room for another thread
+  Job* open_job( ) const;
+
+  std::mutex                mutex_;
+  std::condition_variable   wake_; // A job was added or the pool is stopping
+  std::condition_variable   done_; // A thread left a job
+  std::vector< std::thread > workers_;
+  std::vector< Job* >        jobs_;
+  bool                       stop_ = false;
+};
+
+/*! \brief Calls f( i ) for every i in [0, count) using up to the given number of threads.
+ *
+ *
+ *  Runs on the shared ThreadPool. The calling thread participates. The first
+ *  exception thrown by f is rethrown after all threads complete.
+ */
+template< typename F >
+void parallel_for( std::size_t threads, std::size_t count, F f )
+{
+  threads = std::min( threads, count );
+
+  if ( threads <= 1 )
+  {
+    for ( std::size_t i = 0; i != count; i++ )
+    {
+      f( i );
+    }
+    return;
+  }
+
+  ThreadPool::shared( ).parallel_for( threads, count, f );
+}
+
+/*! \brief Calls f( begin, end ) for consecutive blocks of at most block items of [0, count).
+ *
+ *
+ *  The blocks are processed in parallel as by parallel_for().
+ */
+template< typename F >
+void parallel_for_blocks( std::size_t threads, std::size_t count, std::size_t block, F f )
+{
+  parallel_for( threads, ( count + block - 1 ) / block, [ & ]( std::size_t b ) {
+    f( b * block, std::min( count, ( b + 1 ) * block ) );
+  } );
+}
+
+/*! \brief A first in, first out queue of at most a fixed number of items, which
+ *  hands items over from producer to consumer threads.
+ *
+ *
+ *  push() waits while the queue is full and pop() while it is empty. Once
+ *  close() was called, push() discards its item and pop() takes the remaining
+ *  items, so either side can end the exchange, also after an error.
+ */
+template< typename T >
+class BoundedQueue
+{
+public:
+  //! Creates an open queue of at most capacity items
+  explicit BoundedQueue( std::size_t capacity )
+    : capacity_( std::max< std::size_t >( capacity, 1 ) )
+  {
+  }
+
+  //! Appends item, waiting while the queue is full. Returns false if the queue is closed.
+  bool push( T item )
+  {
+    {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      not_full_.wait( lock, [ this ] { return closed_ || items_.size( ) < capacity_; } );
+
+      if ( closed_ )
+      {
+        return false;
+      }
+      items_.push_back( std::move( item ) );
+    }
+    not_empty_.notify_one( );
+    return true;
+  }
+
+  //! Takes the oldest item, waiting while the queue is empty. Returns false once the queue is
+  //! closed and empty.
+  bool pop( T& item )
+  {
+    {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      not_empty_.wait( lock, [ this ] { return closed_ || !items_.empty( ); } );
+
+      if ( items_.empty( ) )
+      {
+        return false;
+      }
+      item = std::move( items_.front( ) );
+      items_.pop_front( );
+    }
+    not_full_.notify_one( );
+    return true;
+  }
+
+  //! Ends the exchange and wakes all waiting threads
+  void close( )
+  {
+    {
+      std::lock_guard< std::mutex > lock( mutex_ );
+      closed_ = true;
+    }
+    not_full_.notify_all( );
+    not_empty_.notify_all( );
+  }
+
+private:
+  std::mutex              mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque< T >         items_;
+  std::size_t             capacity_;
+  bool                    closed_ = false;
+};
+
+#endif // PARALLEL_HPP
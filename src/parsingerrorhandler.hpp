@@ -43,6 +43,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <vector>
 
 namespace comsol
@@ -66,7 +67,9 @@ struct ErrorHandler
   // template <typename F, typename X, typename Y>
   // struct result<F(X,Y)> { typedef void type; };
 
-  ErrorHandler( Iterator first, Iterator last ) : first( first ), last( last )
+  //! Each message starts with message_prefix, e.g. the job of a batch it comes from
+  ErrorHandler( Iterator first, Iterator last, const std::string& message_prefix = "" ) :
+    first( first ), last( last ), message_prefix( message_prefix )
   {
   }
 
@@ -80,23 +83,28 @@ struct ErrorHandler
 
     int      line;
     Iterator line_start = get_pos( err_pos, line );
+
+    // Written at once, so that the messages of concurrent parses do not interleave
+    std::ostringstream error;
+
+    error << message_prefix;
     if ( err_pos != last )
     {
 
-      std::cerr << message << " Line " << line << ". Expected " << name
-                << " at or after:" << std::endl;
-      std::cerr << get_line( line_start ) << std::endl;
+      error << message << " Line " << line << ". Expected " << name << " at or after:\n";
+      error << get_line( line_start ) << '\n';
 
       for ( ; line_start != err_pos; ++line_start )
-        std::cerr << ' ';
+        error << ' ';
 
-      std::cerr << '^' << std::endl;
+      error << "^\n";
     }
     else
     {
-      std::cerr << "Unexpected end of file. ";
-      std::cerr << message << " Line " << line << ". Expected" << name << "." << std::endl;
+      error << "Unexpected end of file. ";
+      error << message << " Line " << line << ". Expected" << name << ".\n";
     }
+    std::cerr << error.str( ) << std::flush;
   }
 
   Iterator get_pos( Iterator err_pos, int& line ) const
@@ -139,6 +147,7 @@ struct ErrorHandler
 
   Iterator                first;
   Iterator                last;
+  std::string             message_prefix;
   std::vector< Iterator > iters;
 };
 
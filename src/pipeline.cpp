@@ -0,0 +1,293 @@
+#include "pipeline.hpp"
+#include "aerofgenerator.hpp"
+#include "aerosgenerator.hpp"
+#include "charstreamer.hpp"
+#include "comsolparser.hpp"
+#include "converter.hpp"
+#include "mappedfile.hpp"
+#include "outputbuffer.hpp"
+#include "parallel.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <variant>
+
+using namespace std;
+
+namespace
+{
+
+// Parts waiting between two stages. An element set may be large, a couple of them is enough to
+// keep both stages busy.
+const size_t queue_depth = 2;
+
+// Hands part over to the next stage, unless that stage stopped on an error
+template< class Queue, class Part >
+void hand_over( Queue& queue, Part&& part )
+{
+  if ( !queue.push( std::forward< Part >( part ) ) )
+  {
+    throw runtime_error( "Pipeline stopped." );
+  }
+}
+
+template< class Index, class Generator >
+void run_stages( const UserOptions&        options,
+                 comsol::Parser&           parser,
+                 const MappedFile&         input,
+                 aero::BasicMesh< Index >& aero_mesh,
+                 const Generator&          generator,
+                 OutputBuffer&             output )
+{
+  using ElementSet = comsol::BasicElementSet< Index >;
+  using Elements   = typename aero::BasicMesh< Index >::Elements;
+
+  CharStreamer< ostream > stdclog( clog, options.verbose );
+
+  BasicConverter< Index > converter( options.verbose,
+                                     options.use_selections,
+                                     options.element_mapping,
+                                     options.surface_name_prefixes,
+                                     options.accepted_selections,
+                                     options.threads,
+                                     options.message_prefix );
+
+  typename BasicConverter< Index >::Parts parts;
+
+  BoundedQueue< variant< Coordinates, ElementSet > > parsed( queue_depth );
+  BoundedQueue< variant< Coordinates, Elements > >   converted( queue_depth );
+
+  // Errors stop the stages upstream, so an error of a later stage is the cause of the others
+  exception_ptr parse_error;
+  exception_ptr convert_error;
+  exception_ptr generate_error;
+
+  const auto start   = chrono::steady_clock::now( );
+  const auto seconds = [ & ] {
+    return chrono::duration< double >( chrono::steady_clock::now( ) - start ).count( );
+  };
+
+  thread parsing( [ & ] {
+    comsol::MeshHandlers< Index > handlers;
+
+    handlers.points = [ & ]( Coordinates&& points ) { hand_over( parsed, std::move( points ) ); };
+    handlers.element_set = [ & ]( ElementSet&& set ) { hand_over( parsed, std::move( set ) ); };
+
+    // The parsed input is not read again, its pages need not stay in memory
+    const char* released = input.begin( );
+
+    handlers.parsed_up_to = [ & ]( const char* position ) {
+      if ( position > released )
+      {
+        input.release( released, position );
+        released = position;
+      }
+    };
+
+    try
+    {
+      parser.parse( input.begin( ), input.end( ), handlers );
+    }
+    catch ( ... )
+    {
+      parse_error = current_exception( );
+    }
+    parsed.close( );
+
+    stdclog.print( "Parsing stage completed after ", seconds( ), " s" );
+  } );
+
+  thread converting( [ & ] {
+    try
+    {
+      variant< Coordinates, ElementSet > part;
+
+      while ( parsed.pop( part ) )
+      {
+        if ( auto* points = get_if< Coordinates >( &part ) )
+        {
+          hand_over( converted, std::move( *points ) );
+        }
+        else
+        {
+          auto elements
+            = converter.convert_part( std::move( get< ElementSet >( part ) ), parts, aero_mesh );
+
+          if ( !elements.empty( ) )
+          {
+            hand_over( converted, std::move( elements ) );
+          }
+        }
+        part = Coordinates( ); // Releases what is left of the part while waiting
+      }
+
+      // The selections are parsed once the queue is closed
+      if ( !parse_error )
+      {
+        const auto& comsol_mesh = get< comsol::BasicMesh< Index > >( parser.getModel( ) );
+
+        converter.finish_parts( comsol_mesh.selection_object, parts, aero_mesh );
+      }
+    }
+    catch ( ... )
+    {
+      convert_error = current_exception( );
+      parsed.close( );
+    }
+    converted.close( );
+
+    stdclog.print( "Conversion stage completed after ", seconds( ), " s" );
+  } );
+
+  size_t written = 0;
+
+  try
+  {
+    variant< Coordinates, Elements > part;
+
+    while ( converted.pop( part ) )
+    {
+      if ( auto* points = get_if< Coordinates >( &part ) )
+      {
+        aero_mesh.nodes = std::move( *points );
+        generator.write_begin( output );
+        aero_mesh.nodes = Coordinates( ); // Only the nodes section needs them
+      }
+      else
+      {
+        const auto& elements = get< Elements >( part );
+
+        generator.write_part( output, written, elements );
+        written += elements.size( );
+      }
+      part = Coordinates( );
+    }
+  }
+  catch ( ... )
+  {
+    generate_error = current_exception( );
+    converted.close( );
+    parsed.close( );
+  }
+
+  parsing.join( );
+  converting.join( );
+
+  for ( const auto& error : { generate_error, convert_error, parse_error } )
+  {
+    if ( error )
+    {
+      rethrow_exception( error );
+    }
+  }
+
+  generator.write_end( output, written );
+
+  stdclog.print( "Generation stage completed after ", seconds( ), " s (", written, " elements)" );
+}
+
+template< class Index >
+void run_stages( const UserOptions& options,
+                 comsol::Parser&    parser,
+                 const MappedFile&  input,
+                 OutputBuffer&      output )
+{
+  aero::BasicMesh< Index > aero_mesh;
+
+  if ( options.outputs.front( ).aerof == false )
+  {
+    aeros::BasicGenerator< Index > generator(
+      options.verbose, options.matusage, aero_mesh, options.real_format, options.threads );
+
+    run_stages( options, parser, input, aero_mesh, generator, output );
+  }
+  else
+  {
+    aerof::BasicGenerator< Index > generator(
+      options.verbose, aero_mesh, options.real_format, options.threads );
+
+    run_stages( options, parser, input, aero_mesh, generator, output );
+  }
+}
+
+// The aero mesh uses the index type the comsol mesh is parsed with
+void run_stages( const UserOptions& options,
+                 comsol::Parser&    parser,
+                 const MappedFile&  input,
+                 OutputBuffer&      output )
+{
+#ifdef COMSOL2AERO_32BIT_INDICES
+  if ( comsol::fits_index< uint32_t >( parser.mesh_points( input.begin( ), input.end( ) ) ) )
+  {
+    run_stages< uint32_t >( options, parser, input, output );
+    return;
+  }
+#endif
+  run_stages< size_t >( options, parser, input, output );
+}
+
+} // namespace
+
+bool run_pipeline( const UserOptions& options )
+{
+  if ( options.outputs.size( ) != 1 || options.input_file_name == "" )
+  {
+    return false;
+  }
+
+  MappedFile input( options.input_file_name );
+
+  if ( !input.is_mapped( ) )
+  {
+    return false;
+  }
+
+  CharStreamer< ostream > stdclog( clog, options.verbose );
+
+  const string& file_name = options.outputs.front( ).file_name;
+
+  stdclog.print( "\nConverting in a pipeline: ", options.input_file_name, "\n---" );
+
+  comsol::Parser parser( options.verbose, options.threads, options.message_prefix );
+
+  if ( file_name == "" )
+  {
+    OutputBuffer output( std::cout );
+
+    run_stages( options, parser, input, output );
+    return true;
+  }
+
+  bool opened = false;
+
+  try
+  {
+    OutputBuffer output( file_name );
+
+    if ( !output.is_open( ) )
+    {
+      stringstream ss;
+      ss << "Could not open file " << file_name << " for writing.";
+
+      throw runtime_error( ss.str( ) );
+    }
+    opened = true;
+
+    run_stages( options, parser, input, output );
+  }
+  catch ( ... )
+  {
+    if ( opened )
+    {
+      std::remove( file_name.c_str( ) );
+    }
+    throw;
+  }
+
+  return true;
+}
@@ -0,0 +1,78 @@
+#include "realformat.hpp"
+
+#include <boost/spirit/include/karma_generate.hpp>
+#include <boost/spirit/include/karma_real.hpp>
+
+#include <charconv>
+#include <stdexcept>
+
+namespace
+{
+namespace karma = boost::spirit::karma;
+
+// Fixed notation, Karma limits the precision to 16 decimals
+template< typename Num >
+struct FixedPolicy : karma::real_policies< Num >
+{
+  static int floatfield( Num )
+  {
+    return karma::real_policies< Num >::fmtflags::fixed;
+  }
+
+  static bool trailing_zeros( Num )
+  {
+    return true;
+  }
+
+  static unsigned precision( Num )
+  {
+    return 24;
+  }
+};
+
+const karma::real_generator< double, FixedPolicy< double > > fixed_real;
+} // namespace
+
+RealFormat parse_real_format( const std::string& text )
+{
+  RealFormat format;
+
+  if ( text == "fixed" )
+  {
+    format.style = RealFormat::Style::fixed;
+  }
+  else if ( text == "shortest" )
+  {
+    format.style = RealFormat::Style::shortest;
+  }
+  else
+  {
+    const char* last   = text.data( ) + text.size( );
+    auto        result = std::from_chars( text.data( ), last, format.digits );
+
+    if ( result.ec != std::errc( ) || result.ptr != last || format.digits < 1
+         || format.digits > 17 )
+    {
+      throw std::invalid_argument(
+        "--precision must be fixed, shortest or a number of significant digits from 1 to 17." );
+    }
+    format.style = RealFormat::Style::digits;
+  }
+  return format;
+}
+
+char* format_real( char* first, double value, const RealFormat& format )
+{
+  char* last = first + max_real_chars;
+
+  switch ( format.style )
+  {
+  case RealFormat::Style::fixed:
+    karma::generate( first, fixed_real, value );
+    return first;
+  case RealFormat::Style::digits:
+    return std::to_chars( first, last, value, std::chars_format::general, format.digits ).ptr;
+  default:
+    return std::to_chars( first, last, value ).ptr;
+  }
+}
@@ -0,0 +1,32 @@
+#include "sectionwriter.hpp"
+
+void write_nodes( OutputBuffer&      output,
+                  std::size_t        threads,
+                  const Coordinates& nodes,
+                  const RealFormat&  format )
+{
+  const std::size_t dimension = nodes.dimension( );
+  const std::size_t line      = 2 + detail::max_uint_chars + dimension * ( 1 + max_real_chars );
+
+  detail::write_lines(
+    output, threads, nodes.size( ), [ & ]( auto& buffer, std::size_t first, std::size_t last ) {
+      detail::LineNumber number( first + 1 );
+
+      for ( std::size_t i = first; i != last; i++ )
+      {
+        char* end = buffer.reserve( line );
+
+        *end++ = '\n';
+        end    = number.copy( end );
+
+        for ( std::size_t d = 0; d != dimension; d++ )
+        {
+          *end++ = ' ';
+          end    = format_real( end, nodes( i, d ), format );
+        }
+
+        buffer.commit( end );
+        ++number;
+      }
+    } );
+}
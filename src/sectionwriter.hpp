@@ -0,0 +1,367 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef SECTIONWRITER_HPP
+#define SECTIONWRITER_HPP
+
+#include "aeromesh.hpp"
+#include "charstreamer.hpp"
+#include "coordinates.hpp"
+#include "outputbuffer.hpp"
+#include "parallel.hpp"
+#include "realformat.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace detail
+{
+constexpr std::array< char, 200 > make_digit_pairs( )
+{
+  std::array< char, 200 > pairs {};
+  for ( std::size_t i = 0; i != 100; i++ )
+  {
+    pairs[ 2 * i ]     = static_cast< char >( '0' + i / 10 );
+    pairs[ 2 * i + 1 ] = static_cast< char >( '0' + i % 10 );
+  }
+  return pairs;
+}
+
+//! "00", "01", ..., "99"
+constexpr std::array< char, 200 > digit_pairs = make_digit_pairs( );
+
+//! Longest line number or integer written by the section writers
+constexpr std::size_t max_uint_chars = 20;
+
+//! Writes the decimal digits of value at first and returns their end.
+inline char* format_uint( char* first, std::uint64_t value )
+{
+  std::size_t size = 1;
+  for ( std::uint64_t v = value; v >= 10; v /= 10 )
+  {
+    size++;
+  }
+
+  char* last = first + size;
+  char* iter = last;
+
+  // Two digits per division
+  while ( value >= 100 )
+  {
+    iter -= 2;
+    std::memcpy( iter, digit_pairs.data( ) + 2 * ( value % 100 ), 2 );
+    value /= 100;
+  }
+  if ( value >= 10 )
+  {
+    std::memcpy( first, digit_pairs.data( ) + 2 * value, 2 );
+  }
+  else
+  {
+    *first = static_cast< char >( '0' + value );
+  }
+  return last;
+}
+
+/*! \brief The number of the current line, kept as decimal digits.
+ *
+ *
+ *  Lines are numbered consecutively, so incrementing the digits in place is
+ *  cheaper than formatting every number.
+ */
+class LineNumber
+{
+public:
+  explicit LineNumber( std::uint64_t number = 1 )
+  {
+    digits_.fill( '0' );
+
+    char* last = digits_.data( ) + max_uint_chars;
+    char  text[ max_uint_chars ];
+    const std::size_t size = static_cast< std::size_t >( format_uint( text, number ) - text );
+
+    std::memcpy( last - size, text, size );
+    first_ = max_uint_chars - size;
+  }
+
+  /*! \brief Writes the number at out and returns the end of its digits.
+   *
+   *  max_uint_chars characters are overwritten.
+   */
+  char* copy( char* out ) const
+  {
+    std::memcpy( out, digits_.data( ) + first_, max_uint_chars );
+    return out + ( max_uint_chars - first_ );
+  }
+
+  LineNumber& operator++( )
+  {
+    std::size_t i = max_uint_chars - 1;
+    while ( digits_[ i ] == '9' )
+    {
+      digits_[ i-- ] = '0';
+    }
+    digits_[ i ]++;
+    first_ = std::min( first_, i );
+    return *this;
+  }
+
+private:
+  std::array< char, 2 * max_uint_chars > digits_; // Right aligned in the first half
+  std::size_t                            first_;
+};
+
+//! Growable memory buffer with the reserve() and commit() of OutputBuffer
+class ChunkBuffer
+{
+public:
+  char* reserve( std::size_t size )
+  {
+    if ( data_.size( ) - size_ < size )
+    {
+      data_.resize( std::max( 2 * data_.size( ), size_ + size ) );
+    }
+    return data_.data( ) + size_;
+  }
+
+  void commit( char* last )
+  {
+    size_ = static_cast< std::size_t >( last - data_.data( ) );
+  }
+
+  void clear( )
+  {
+    size_ = 0;
+  }
+
+  const char* data( ) const
+  {
+    return data_.data( );
+  }
+
+  std::size_t size( ) const
+  {
+    return size_;
+  }
+
+private:
+  std::vector< char > data_;
+  std::size_t         size_ = 0;
+};
+
+//! Appends the line of element to output, an OutputBuffer or a ChunkBuffer.
+template< class Output, class Element >
+void write_element( Output& output, LineNumber& number, const Element& element )
+{
+  const std::size_t nodes = element.nodes.size( );
+
+  char* last = output.reserve( ( 3 + nodes ) * ( 1 + max_uint_chars ) );
+  char* end  = last;
+
+  *end++ = '\n';
+  end    = number.copy( end );
+  *end++ = ' ';
+  end    = format_uint( end, element.type );
+
+  for ( std::size_t k = 0; k != nodes; k++ )
+  {
+    *end++ = ' ';
+    end    = format_uint( end, element.nodes[ k ] );
+  }
+
+  output.commit( end );
+  ++number;
+}
+
+/*! \brief Writes count lines, formatted in parallel chunks and written in order.
+ *
+ *
+ *  format( buffer, first, last ) appends lines [first, last) to buffer, an
+ *  OutputBuffer or a ChunkBuffer. Only a few chunks per thread are held in
+ *  memory at any time. The output does not depend on the number of threads.
+ */
+template< class Format >
+void write_lines( OutputBuffer&  output,
+                  std::size_t    threads,
+                  std::size_t    count,
+                  const Format&  format )
+{
+  const std::size_t chunk  = std::size_t( 1 ) << 14;
+  const std::size_t chunks = ( count + chunk - 1 ) / chunk;
+
+  threads = std::min( threads, chunks );
+
+  if ( threads <= 1 )
+  {
+    format( output, 0, count );
+    return;
+  }
+
+  std::vector< ChunkBuffer > buffers( std::min( chunks, 4 * threads ) );
+
+  for ( std::size_t wave = 0; wave < chunks; wave += buffers.size( ) )
+  {
+    const std::size_t size = std::min( buffers.size( ), chunks - wave );
+
+    parallel_for( threads, size, [ & ]( std::size_t c ) {
+      const std::size_t first = ( wave + c ) * chunk;
+
+      buffers[ c ].clear( );
+      format( buffers[ c ], first, std::min( count, first + chunk ) );
+    } );
+
+    for ( std::size_t c = 0; c != size; c++ )
+    {
+      output.write( buffers[ c ].data( ), buffers[ c ].size( ) );
+    }
+  }
+}
+} // namespace detail
+
+//! Writes characters as they are, e.g. a section title
+inline void write_text( OutputBuffer& output, const std::string& characters )
+{
+  output.write( characters.data( ), characters.size( ) );
+}
+
+//! Writes a section with write_section(), reporting its size and throughput to log
+template< class F >
+void write_timed( OutputBuffer&                       output,
+                  const CharStreamer< std::ostream >& log,
+                  const char*                         name,
+                  const F&                            write_section )
+{
+  const auto        start = std::chrono::steady_clock::now( );
+  const std::size_t size  = output.size( );
+
+  write_section( );
+
+  const std::chrono::duration< double > elapsed = std::chrono::steady_clock::now( ) - start;
+  const double                          mb      = ( output.size( ) - size ) / 1.e6;
+
+  log.print(
+    "  ", name, ": ", mb, " MB in ", elapsed.count( ), " s (", mb / elapsed.count( ), " MB/s)" );
+}
+
+/*! \brief Writes one line per node: its number, starting from 1, and its coordinates.
+ *
+ *
+ *  Every line starts with a new line, so that the lines follow a title.
+ *  Lines are formatted by up to threads threads.
+ */
+void write_nodes( OutputBuffer&      output,
+                  std::size_t        threads,
+                  const Coordinates& nodes,
+                  const RealFormat&  format );
+
+/*! \brief Writes one line per element: its number, starting from number, its type and its
+ *  nodes.
+ *
+ *
+ *  Every line starts with a new line, so that the lines follow a title or
+ *  the lines of the previous elements. Lines are formatted by up to threads
+ *  threads.
+ */
+template< class Index >
+void write_elements( OutputBuffer&                    output,
+                     std::size_t                      threads,
+                     const aero::ElementList< Index >& elements,
+                     std::uint64_t                    number = 1 )
+{
+  detail::write_lines(
+    output, threads, elements.size( ), [ & ]( auto& buffer, std::size_t first, std::size_t last ) {
+      detail::LineNumber line( number + first );
+
+      // Finds the run of the first element only
+      auto element = typename aero::ElementList< Index >::const_iterator( &elements, first );
+
+      for ( std::size_t i = first; i != last; i++, ++element )
+      {
+        detail::write_element( buffer, line, *element );
+      }
+    } );
+}
+
+//! Writes the elements of a view, as write_elements() but on the calling thread only.
+template< class Index >
+void write_elements( OutputBuffer& output, const aero::ElementListView< Index >& elements )
+{
+  detail::LineNumber number;
+
+  for ( const auto element : elements )
+  {
+    detail::write_element( output, number, element );
+  }
+}
+
+/*! \brief Writes one line per value: its number, starting from 1, and the value.
+ *
+ *
+ *  Every line starts with a new line, so that the lines follow a title.
+ *  Lines are formatted by up to threads threads.
+ */
+template< class Values >
+void write_values( OutputBuffer& output, std::size_t threads, const Values& values )
+{
+  detail::write_lines(
+    output, threads, values.size( ), [ & ]( auto& buffer, std::size_t first, std::size_t last ) {
+      detail::LineNumber number( first + 1 );
+
+      for ( std::size_t i = first; i != last; i++ )
+      {
+        char* end = buffer.reserve( 3 * ( 1 + detail::max_uint_chars ) );
+
+        *end++ = '\n';
+        end    = number.copy( end );
+        *end++ = ' ';
+        end    = detail::format_uint( end, values[ i ] );
+
+        buffer.commit( end );
+        ++number;
+      }
+    } );
+}
+
+#endif // SECTIONWRITER_HPP
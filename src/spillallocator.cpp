@@ -0,0 +1,178 @@
+#include "spillallocator.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <linux/magic.h>
+#include <sys/vfs.h>
+#endif
+
+namespace
+{
+std::atomic< std::size_t > memory_limit( 0 );
+std::atomic< std::size_t > spilled( 0 );
+std::string                directory; // Set before any allocation
+} // namespace
+
+void set_memory_limit( std::size_t bytes )
+{
+  memory_limit = bytes;
+}
+
+std::size_t spilled_memory( )
+{
+  return spilled;
+}
+
+void set_spill_directory( const std::string& spill_directory )
+{
+  directory = spill_directory;
+}
+
+std::string spill_directory( )
+{
+  if ( !directory.empty( ) )
+  {
+    return directory;
+  }
+
+  const char* temporary = std::getenv( "TMPDIR" );
+
+  return temporary != nullptr && *temporary ? temporary : "/tmp";
+}
+
+bool spill_directory_in_memory( )
+{
+#ifdef __linux__
+  struct statfs file_system;
+
+  return statfs( spill_directory( ).c_str( ), &file_system ) == 0
+         && ( file_system.f_type == TMPFS_MAGIC || file_system.f_type == RAMFS_MAGIC );
+#else
+  return false;
+#endif
+}
+
+#ifdef _MSC_VER
+
+void* spill_allocate( std::size_t bytes )
+{
+  return ::operator new( bytes );
+}
+
+void spill_deallocate( void* p, std::size_t ) noexcept
+{
+  ::operator delete( p );
+}
+
+#else
+
+#include <mutex>
+#include <set>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+std::atomic< std::size_t > in_memory( 0 ); // Blocks of at least spill_threshold bytes
+std::atomic< bool >        any_spilled( false );
+std::mutex                 spill_mutex;
+std::set< void* >          spill_blocks; // Blocks mapped from temporary files
+
+// Maps bytes from a new temporary file, nullptr if that fails
+void* map_temporary( std::size_t bytes )
+{
+  std::string name = spill_directory( ) + "/comsol2aero.XXXXXX";
+
+  const int file = mkstemp( &name[ 0 ] );
+
+  if ( file < 0 )
+  {
+    return nullptr;
+  }
+  unlink( name.c_str( ) ); // Deleted once unmapped
+
+  void* p = nullptr;
+
+  if ( ftruncate( file, static_cast< off_t >( bytes ) ) == 0 )
+  {
+    p = mmap( nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0 );
+  }
+  close( file );
+
+  return p != MAP_FAILED ? p : nullptr;
+}
+} // namespace
+
+void* spill_allocate( std::size_t bytes )
+{
+  if ( bytes < spill_threshold )
+  {
+    return ::operator new( bytes );
+  }
+
+  const std::size_t limit = memory_limit;
+
+  // Reserves the bytes before allocating, so that concurrent allocations cannot together
+  // exceed the limit
+  std::size_t reserved = in_memory.load( );
+  bool        fits     = false;
+
+  while ( ( fits = limit == 0 || reserved + bytes <= limit )
+          && !in_memory.compare_exchange_weak( reserved, reserved + bytes ) )
+  {
+  }
+
+  if ( fits )
+  {
+    try
+    {
+      return ::operator new( bytes );
+    }
+    catch ( ... )
+    {
+      in_memory -= bytes;
+      throw;
+    }
+  }
+
+  void* p = map_temporary( bytes );
+
+  if ( p == nullptr )
+  {
+    throw std::bad_alloc( );
+  }
+
+  std::lock_guard< std::mutex > lock( spill_mutex );
+
+  spill_blocks.insert( p );
+  any_spilled = true;
+  spilled += bytes;
+
+  return p;
+}
+
+void spill_deallocate( void* p, std::size_t bytes ) noexcept
+{
+  if ( bytes >= spill_threshold && any_spilled )
+  {
+    std::lock_guard< std::mutex > lock( spill_mutex );
+
+    if ( spill_blocks.erase( p ) != 0 )
+    {
+      munmap( p, bytes );
+      spilled -= bytes;
+      return;
+    }
+  }
+
+  if ( bytes >= spill_threshold )
+  {
+    in_memory -= bytes;
+  }
+  ::operator delete( p );
+}
+
+#endif
@@ -0,0 +1,121 @@
+// comsol2aero: a comsol mesh to frg aero mesh Converter
+
+// AUTHORIZATION TO USE AND DISTRIBUTE. By using or distributing the comsol2aero software
+// ("THE SOFTWARE"), you agree to the following terms governing the use and redistribution of
+// THE SOFTWARE originally developed at the U.S. Naval Research Laboratory ("NRL"), Computational
+// Multiphysics Systems Lab., Code 6394.
+
+// The modules of comsol2aero containing an attribution in their header files to the NRL have been
+// authored by federal employees. To the extent that a federal employee is an author of a portion of
+// this software or a derivative work thereof, no copyright is claimed by the United States
+// Government, as represented by the Secretary of the Navy ("GOVERNMENT") under Title 17, U.S. Code.
+// All Other Rights Reserved.
+
+// Download, redistribution and use of source and/or binary forms, with or without modification,
+// constitute an acknowledgement and agreement to the following:
+
+// (1) source code distributions retain the above notice, this list of conditions, and the
+// following disclaimer in its entirety,
+// (2) distributions including binary code include this paragraph in its entirety in the
+// documentation or other materials provided with the distribution, and
+// (3) all published research using this software display the following acknowledgment:
+// "This work uses the software components contained within the NRL comsol2aero computer package
+// written and developed by the U.S. Naval Research Laboratory, Computational Multiphysics Systems
+// lab., Code 6394"
+
+// Neither the name of NRL or its contributors, nor any entity of the United States Government may
+// be used to endorse or promote products derived from this software, nor does the inclusion of the
+// NRL written and developed software directly or indirectly suggest NRL's or the United States
+// Government's endorsement of this product.
+
+// THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+// NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR THE U.S. GOVERNMENT BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NOTICE OF THIRD-PARTY SOFTWARE LICENSES. This software uses open source software packages from
+// third parties. These are available on an "as is" basis and subject to their individual license
+// agreements. Additional information can be found in the provided "licenses" folder.
+#ifndef SPILLALLOCATOR_HPP
+#define SPILLALLOCATOR_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*! \brief Limits the memory taken by the large mesh arrays and by the
+ *  blocks of a streamed input.
+ *
+ *
+ *  Once the blocks of at least spill_threshold bytes allocated through
+ *  spill_allocate, e.g. by SpillAllocator, exceed bytes, the following ones are mapped from
+ *  temporary files, which the system writes back to disk instead of
+ *  running out of memory. 0 removes the limit. Temporary files are created
+ *  in the spill directory and deleted right away. Only available on POSIX
+ *  systems, elsewhere the limit has no effect.
+ */
+void set_memory_limit( std::size_t bytes );
+
+/*! \brief Sets the directory of the temporary files, TMPDIR or /tmp if
+ *  empty. Must be set before the first array is allocated.
+ */
+void set_spill_directory( const std::string& directory );
+
+std::string spill_directory( );
+
+/*! \brief Whether the spill directory is held in memory, e.g. a tmpfs /tmp,
+ *  in which case mapping arrays from it saves no memory.
+ */
+bool spill_directory_in_memory( );
+
+//! Bytes currently mapped from temporary files
+std::size_t spilled_memory( );
+
+//! Smallest block that counts against the limit
+constexpr std::size_t spill_threshold = std::size_t( 1 ) << 20;
+
+void* spill_allocate( std::size_t bytes );
+void  spill_deallocate( void* p, std::size_t bytes ) noexcept;
+
+/*! \brief Allocator of the large mesh arrays, see set_memory_limit.
+ */
+template< class T >
+struct SpillAllocator
+{
+  using value_type = T;
+
+  SpillAllocator( ) = default;
+
+  template< class U >
+  SpillAllocator( const SpillAllocator< U >& )
+  {
+  }
+
+  T* allocate( std::size_t n )
+  {
+    return static_cast< T* >( spill_allocate( n * sizeof( T ) ) );
+  }
+
+  void deallocate( T* p, std::size_t n ) noexcept
+  {
+    spill_deallocate( p, n * sizeof( T ) );
+  }
+};
+
+template< class T, class U >
+bool operator==( const SpillAllocator< T >&, const SpillAllocator< U >& )
+{
+  return true;
+}
+
+template< class T, class U >
+bool operator!=( const SpillAllocator< T >&, const SpillAllocator< U >& )
+{
+  return false;
+}
+
+template< class T >
+using SpillVector = std::vector< T, SpillAllocator< T > >;
+
+#endif // SPILLALLOCATOR_HPP